@@ -5,9 +5,11 @@
 
 // -- Player initialized with 200ms as base time-span.
 TonePlayer tonePlayer(BEEPER_PIN, 200);
+// -- The melody is parsed by the compiler, the notes stay in the flash.
+static constexpr auto melody = compileMelody("c1g1c1g1j2j2c1g1c1g1j2j2o1n1l1j1h2l2_2j1h1g1e1c2c2");
 
 void setup(void)
 {
-  tonePlayer.play("c1g1c1g1j2j2c1g1c1g1j2j2o1n1l1j1h2l2_2j1h1g1e1c2c2");
+  tonePlayer.play(melody);
 }
 
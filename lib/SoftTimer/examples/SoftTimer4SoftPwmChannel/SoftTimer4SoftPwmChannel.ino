@@ -0,0 +1,32 @@
+#include <SoftTimer.h>
+#include <SoftPwmChannel.h>
+
+/* In this demonstration three outputs are dimmed by the same timer interrupt, with a phase shift between them. */
+
+// -- Define method signatures.
+void shift(Task* me);
+
+// -- The channels do not need to be added to the SoftTimer.
+SoftPwmChannel red(5);
+SoftPwmChannel green(6);
+SoftPwmChannel blue(9);
+// -- This task will change the PWM values. Will be called in every 20 milliseconds.
+Task shiftTask(20, shift);
+
+byte value = 0;
+
+void setup(void)
+{
+  // -- All channels run at 200 Hz.
+  SoftPwmEngine.begin(200);
+
+  // -- Register the shift task.
+  SoftTimer.add(&shiftTask);
+}
+
+void shift(Task* me) {
+  red.analogWrite(value);
+  green.analogWrite(value + 85);
+  blue.analogWrite(value + 170);
+  value += 5;
+}
@@ -27,12 +27,7 @@
 #include "BlinkTask.h"
 #include "SoftTimer.h"
 
-#define BLINK_STATE_OFF  0
-#define BLINK_STATE_ON   1
-#define BLINK_STATE_WAIT 2
-
-void BlinkTask::setupProperties(byte outPin, unsigned long onMs, unsigned long offMs, byte count, unsigned long delayMs) {
-  this->_outPin = outPin;
+void BlinkTask::setupProperties(unsigned long onMs, unsigned long offMs, byte count, unsigned long delayMs) {
   this->onMs = onMs;
   this->offMs = offMs;
   this->count = count;
@@ -41,34 +36,35 @@ void BlinkTask::setupProperties(byte outPin, unsigned long onMs, unsigned long o
 }
 
 void BlinkTask::init() {
-  pinMode(this->_outPin, OUTPUT);
-  this->_bitMask = digitalPinToBitMask(this->_outPin);
-  this->_portRegister = portOutputRegister(digitalPinToPort(this->_outPin));
+  this->_pin.output();
 
   // -- Turn off.
-  if(this->onLevel == HIGH) {
-    *this->_portRegister &= ~this->_bitMask;
-  } else {  
-    *this->_portRegister |= this->_bitMask;
-  }
+  this->_pin.write(this->onLevel != HIGH);
   Task::init();
 }
 
-BlinkTask::BlinkTask(byte outPin, unsigned long onOffMs) : Task(onOffMs, &(BlinkTask::stepState)) {
-  this->setupProperties(outPin, onOffMs, onOffMs, 0, 0);
+BlinkTask::BlinkTask(byte outPin, unsigned long onOffMs) : Task(onOffMs, &(BlinkTask::stepState)), _pin(outPin) {
+  this->setupProperties(onOffMs, onOffMs, 0, 0);
 }
 
-BlinkTask::BlinkTask(byte outPin, unsigned long onMs, unsigned long offMs) : Task(onMs, &(BlinkTask::stepState)) {
-  this->setupProperties(outPin, onMs, offMs, 0, 0);
+BlinkTask::BlinkTask(byte outPin, unsigned long onMs, unsigned long offMs)
+  : Task(onMs, &(BlinkTask::stepState)), _pin(outPin) {
+  this->setupProperties(onMs, offMs, 0, 0);
 }
 
-BlinkTask::BlinkTask(byte outPin, unsigned long onMs,unsigned long offMs, byte count) : Task(onMs, &(BlinkTask::stepState)) {
-  this->setupProperties(outPin, onMs, offMs, count, 0);
+BlinkTask::BlinkTask(byte outPin, unsigned long onMs,unsigned long offMs, byte count)
+  : Task(onMs, &(BlinkTask::stepState)), _pin(outPin) {
+  this->setupProperties(onMs, offMs, count, 0);
 }
 
 BlinkTask::BlinkTask(byte outPin, unsigned long onMs, unsigned long offMs, byte count, unsigned long delayMs)
-  : Task(onMs, &(BlinkTask::stepState)) {
-  this->setupProperties(outPin, onMs, offMs, count, delayMs);
+  : Task(onMs, &(BlinkTask::stepState)), _pin(outPin) {
+  this->setupProperties(onMs, offMs, count, delayMs);
+}
+
+BlinkTask::BlinkTask(byte outPin, unsigned long onMs, unsigned long offMs, byte count, unsigned long delayMs,
+  void (*callback)(Task* me)) : Task(onMs, callback), _pin(outPin) {
+  this->setupProperties(onMs, offMs, count, delayMs);
 }
 
 void BlinkTask::start() {
@@ -90,39 +86,5 @@ void BlinkTask::stop() {
 }
 
 void BlinkTask::stepState(Task* task) {
-  BlinkTask* bt = (BlinkTask*)task;
-  if(bt->_state == BLINK_STATE_ON) {
-    // -- Turn off.
-    if(bt->onLevel == HIGH) {
-      *bt->_portRegister &= ~bt->_bitMask;
-    } else {  
-      *bt->_portRegister |= bt->_bitMask;
-    }
-    bt->_counter += 1;
-    bt->_state = BLINK_STATE_OFF;
-    bt->setPeriodMs(bt->offMs);
-  }
-  else {
-    // -- state == OFF or WAIT
-    // -- Turn on.
-    if(bt->onLevel == HIGH) {
-      *bt->_portRegister |= bt->_bitMask;
-    } else {  
-      *bt->_portRegister &= ~bt->_bitMask;
-    }
-    bt->_state = BLINK_STATE_ON;
-    bt->setPeriodMs(bt->onMs);
-  }
-  if((bt->count > 0) && (bt->_counter >= bt->count)) {
-    // -- Count was defined, and we reached it.
-    bt->_counter = 0;
-    
-    if(bt->delayMs > 0) {
-      // -- delay was defined.
-      bt->_state = BLINK_STATE_WAIT;
-      bt->setPeriodMs(bt->delayMs);
-    } else {
-      bt->stop();
-    }
-  }
+  BlinkTask::stepPin(task, ((BlinkTask*)task)->_pin);
 }
@@ -27,8 +27,13 @@
 #ifndef BLINKTASK_H
 #define BLINKTASK_H
 
+#define BLINK_STATE_OFF  0
+#define BLINK_STATE_ON   1
+#define BLINK_STATE_WAIT 2
+
 #include <Arduino.h>
 #include "Task.h"
+#include "FastPin.h"
 
 class BlinkTask : public Task
 {
@@ -102,20 +107,73 @@ class BlinkTask : public Task
     /** Pin level for the ON state. By default the ON means HIGH, you can change this to be LOW. */
     byte onLevel;
 
+  protected:
+    /**
+     * For the subclasses that drive the pin by their own step callback.
+     */
+    BlinkTask(byte outPin, unsigned long onMs, unsigned long offMs, byte count, unsigned long delayMs,
+      void (*callback)(Task* me));
+
+    /**
+     * Switches the pin to the next state, for both pin types of FastPin.h.
+     */
+    template<class Pin>
+    static void stepPin(Task* task, const Pin& pin);
+
   private:
-    void setupProperties(byte outPin, unsigned long onMs, unsigned long offMs, byte count, unsigned long delayMs);
+    void setupProperties(unsigned long onMs, unsigned long offMs, byte count, unsigned long delayMs);
     static void stepState(Task* me);
     byte _counter;
     /** Can be STATE_OFF, STATE_ON, STATE_WAIT */
     byte _state;
 
-    byte _outPin;
-    uint8_t _bitMask;
-//#ifndef ESP8266
-//    volatile uint8_t *_portRegister;
-//#else
-    volatile uint32_t *_portRegister;
-//#endif
+    RuntimePin _pin;
+};
+
+template<class Pin>
+void BlinkTask::stepPin(Task* task, const Pin& pin) {
+  BlinkTask* bt = (BlinkTask*)task;
+  if(bt->_state == BLINK_STATE_ON) {
+    // -- Turn off.
+    pin.write(bt->onLevel != HIGH);
+    bt->_counter += 1;
+    bt->_state = BLINK_STATE_OFF;
+    bt->setPeriodMs(bt->offMs);
+  }
+  else {
+    // -- state == OFF or WAIT
+    // -- Turn on.
+    pin.write(bt->onLevel == HIGH);
+    bt->_state = BLINK_STATE_ON;
+    bt->setPeriodMs(bt->onMs);
+  }
+  if((bt->count > 0) && (bt->_counter >= bt->count)) {
+    // -- Count was defined, and we reached it.
+    bt->_counter = 0;
+    
+    if(bt->delayMs > 0) {
+      // -- delay was defined.
+      bt->_state = BLINK_STATE_WAIT;
+      bt->setPeriodMs(bt->delayMs);
+    } else {
+      bt->stop();
+    }
+  }
+}
+
+/**
+ * BlinkTask on a pin known at compile time, e.g. FastBlinkTask<LED_BUILTIN>. See the BlinkTask constructors for the
+ * parameters.
+ */
+template<uint8_t PIN>
+class FastBlinkTask : public BlinkTask
+{
+  public:
+    FastBlinkTask(unsigned long onMs, unsigned long offMs, byte count = 0, unsigned long delayMs = 0)
+      : BlinkTask(PIN, onMs, offMs, count, delayMs, &(FastBlinkTask::stepState)) {}
+
+  private:
+    static void stepState(Task* task) { BlinkTask::stepPin(task, FastPin<PIN>()); }
 };
 
 #endif
@@ -0,0 +1,40 @@
+/**
+ * File: CompileTime.h
+ * Description:
+ * SoftTimer library is a lightweight but effective event based timeshare solution for Arduino.
+ *
+ * Copying permission statement:
+    This file is part of SoftTimer.
+
+    SoftTimer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef COMPILETIME_H
+#define COMPILETIME_H
+
+#include <stddef.h>
+
+/**
+ * Helpers of the tables that are computed by the compiler (C++11).
+ */
+namespace CompileTime {
+  /** 0, 1, ... N-1 as a template parameter pack, for a table of N entries computed from the index. */
+  template<size_t... I> struct Indices {};
+  template<size_t N, size_t... I> struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+  template<size_t... I> struct MakeIndices<0, I...> { typedef Indices<I...> type; };
+}
+
+#endif
@@ -31,8 +31,7 @@
 #define IDDLE_TIME_MICROS -1L
 
 Debouncer::Debouncer(int pin, int pushMode, void (*onPressed)(), void (*onReleased)(unsigned long pressTimespan), bool pullUp)
-    : Task(IDDLE_TIME_MICROS, &(Debouncer::step)) {
-  this->_pin = pin;
+    : Task(IDDLE_TIME_MICROS, &(Debouncer::step)), _pin(pin) {
   this->_onLevel = pushMode;
   this->_onPressed = onPressed;
   this->_onReleased = onReleased;
@@ -42,11 +41,11 @@ Debouncer::Debouncer(int pin, int pushMode, void (*onPressed)(), void (*onReleas
 void Debouncer::init()
 {
   if(this->_pullUp) {
-    pinMode(this->_pin, INPUT_PULLUP);
+    this->_pin.input(INPUT_PULLUP);
   } else {
-    pinMode(this->_pin, INPUT);
+    this->_pin.input(INPUT);
   }
-  this->_state = digitalRead(this->_pin) == this->_onLevel ? STATE_ON : STATE_OFF;
+  this->_state = (this->_pin.read() ? HIGH : LOW) == this->_onLevel ? STATE_ON : STATE_OFF;
 
   Task::init();
 
@@ -57,7 +56,7 @@ void Debouncer::pciHandleInterrupt(byte vect) {
   if((this->_state == STATE_OFF) || (this->_state == STATE_ON)) {
     int oppositeLevel = this->_state == STATE_OFF ? this->_onLevel : !this->_onLevel;
     // -- Test pin level, probably more pins are used by this interrupt.
-    volatile int val = digitalRead(this->_pin);
+    volatile int val = this->_pin.read() ? HIGH : LOW;
     if(val == oppositeLevel) {
       if(this->_state == STATE_OFF) {
         this->_pressStart = millis(); // -- Save the first time to the start of this task.
@@ -75,7 +74,7 @@ void Debouncer::step(Task* task) {
   if((debouncer->_state == STATE_OFF) || (debouncer->_state == STATE_ON)) {
 	  return;
   }
-  int val = digitalRead(debouncer->_pin);
+  int val = debouncer->_pin.read() ? HIGH : LOW;
   debouncer->setPeriodMs(IDDLE_TIME_MICROS);
   if(debouncer->_state == STATE_OFFON_BOUNCING) {
     if(val == debouncer->_onLevel) {
@@ -29,6 +29,7 @@
 
 #include "SoftTimer.h"
 #include "DelayRun.h"
+#include "FastPin.h"
 #include <PciListener.h>
 //#include "../PciManager/PciListener.h"
 #include <Arduino.h>
@@ -74,7 +75,7 @@ class Debouncer : public PciListener, public Task
     unsigned long debounceDelayMicros = DEFAULT_DEBOUNCE_DELAY_MICROS;
     boolean setDebounceDelayMs(unsigned long debounceDelayMs) { this->debounceDelayMicros = debounceDelayMs * 1000; return true; };
   private:
-    int _pin;
+    RuntimePin _pin;
     int _onLevel;
     bool _pullUp;
     volatile int _state; // 0=off, 1=bouncing, 2=pressing
@@ -32,6 +32,7 @@ Dimmer::Dimmer(SoftPwmTask* pwm, int frequencyMs, byte stepCount) : Task(10, &(D
   this->_pwm = pwm;
   this->direction = DIMMER_DIRECTION_HIGH;
   this->value = 0;
+  this->easing = DIMMER_EASE_LINEAR;
   this->stepCount = stepCount;
 
   this->setFrequency(frequencyMs);
@@ -39,7 +40,7 @@ Dimmer::Dimmer(SoftPwmTask* pwm, int frequencyMs, byte stepCount) : Task(10, &(D
 
 void Dimmer::init()
 {
-  this->_pwm->analogWrite((byte)this->value);
+  this->_pwm->analogWrite(this->output());
   Task::init();
 }
 
@@ -63,7 +64,7 @@ void Dimmer::off() {
 
 void Dimmer::on() {
   this->hold();
-  this->value = this->_pwm->upperLimit;
+  this->value = DIMMER_FULL;
   this->_pwm->analogWrite(this->_pwm->upperLimit);
   this->direction = DIMMER_DIRECTION_LOW;
 }
@@ -73,14 +74,18 @@ void Dimmer::revertDirection() {
 }
 
 void Dimmer::setFrequency(int frequencyMs) {
-  this->_stepLevel = (float)this->_pwm->upperLimit / (float)this->stepCount;
-  this->periodMicros = (float)frequencyMs * 500.0 / (float)this->stepCount;
+  this->_stepLevel = DIMMER_FULL / this->stepCount;
+  this->periodMicros = (unsigned long)frequencyMs * 500 / this->stepCount;
 }
 
 byte Dimmer::getUpperLimit() {
   return this->_pwm->upperLimit;
 }
 
+byte Dimmer::output() const {
+  return (uint16_t)DimmerCurve::duty(this->value, this->easing) * this->_pwm->upperLimit / 255;
+}
+
 
 void Dimmer::step(Task* task)
 {
@@ -88,18 +93,19 @@ void Dimmer::step(Task* task)
   
   boolean isOnLimit = false;
   
-  dimmer->value += dimmer->direction * dimmer->_stepLevel;
-  if((dimmer->direction < 0) && (dimmer->value < 0)) {
-    dimmer->value = 0;
+  int32_t value = (int32_t)dimmer->value + dimmer->direction * (int32_t)dimmer->_stepLevel;
+  if((dimmer->direction < 0) && (value <= 0)) {
+    value = 0;
     dimmer->direction *= -1; // -- next time go in the other direction
     isOnLimit = true;
-  } else if((dimmer->direction > 0) && (dimmer->value > dimmer->_pwm->upperLimit)) {
-    dimmer->value = dimmer->_pwm->upperLimit;
+  } else if((dimmer->direction > 0) && (value >= (int32_t)DIMMER_FULL)) {
+    value = DIMMER_FULL;
     dimmer->direction *= -1; // -- next time go in the other direction
     isOnLimit = true;
   }
+  dimmer->value = value;
   
-  dimmer->_pwm->analogWrite((byte)dimmer->value);
+  dimmer->_pwm->analogWrite(dimmer->output());
   
   if(isOnLimit && dimmer->stopOnLimit) {
     SoftTimer.remove(dimmer);
@@ -29,6 +29,7 @@
 
 #include "Task.h"
 #include "SoftPwmTask.h"
+#include "DimmerCurve.h"
 #include "Arduino.h"
 
 #define DIMMER_DIRECTION_HIGH 1
@@ -92,9 +93,15 @@ class Dimmer : public Task
     byte getUpperLimit();
    
     /**
-     * Current dim level PWM value. Note that the maximum is pwm->upperLimit.
+     * Current position of the dimming in Q8.8 fixed point, between 0 (off) and DIMMER_FULL (pwm->upperLimit). The
+     * PWM value is the position on the easing curve, gamma corrected.
      */
-    float value;
+    uint16_t value;
+
+    /**
+     * The curve of the perceived brightness along the dimming, DIMMER_EASE_LINEAR by default.
+     */
+    DimmerEasing easing;
     
     /**
      * Stop if zero, or pwm->upperLimit is reached.
@@ -102,9 +109,9 @@ class Dimmer : public Task
     boolean stopOnLimit;
      
     /**
-     * Can be one of DIMMER_DIRECTION_HIGH or DIMMER_DIRECTION_LOW.
+     * Can be one of DIMMER_DIRECTION_HIGH or DIMMER_DIRECTION_LOW. (Signed: a char is unsigned on ARM.)
      */
-    char direction;
+    int8_t direction;
     
     /**
      * Level-arranging steps should be performed within each full OFF->ON change. Will be applied if setFrequency() is called.
@@ -113,7 +120,8 @@ class Dimmer : public Task
      
   private:
     SoftPwmTask* _pwm;
-    float _stepLevel;
+    uint16_t _stepLevel;
+    byte output() const;
     static void step(Task* me);
 };
 
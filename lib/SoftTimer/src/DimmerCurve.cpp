@@ -0,0 +1,45 @@
+/**
+ * File: DimmerCurve.cpp
+ * Description:
+ * SoftTimer library is a lightweight but effective event based timeshare solution for Arduino.
+ *
+ * Copying permission statement:
+    This file is part of SoftTimer.
+
+    SoftTimer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "DimmerCurve.h"
+
+namespace DimmerCurve {
+  static constexpr DimmerCurveTable EASINGS[DIMMER_EASINGS] = {
+    easingTable(DIMMER_EASE_LINEAR, MakeIndices<256>::type()),
+    easingTable(DIMMER_EASE_IN, MakeIndices<256>::type()),
+    easingTable(DIMMER_EASE_OUT, MakeIndices<256>::type()),
+    easingTable(DIMMER_EASE_IN_OUT, MakeIndices<256>::type())
+  };
+
+  static constexpr DimmerCurveTable GAMMA = gammaTable(MakeIndices<256>::type());
+}
+
+byte DimmerCurve::duty(uint16_t position, DimmerEasing easing, byte bottom, byte top)
+{
+  // -- Rounded to the nearest entry.
+  const byte eased = EASINGS[easing < DIMMER_EASINGS ? easing : DIMMER_EASE_LINEAR].level[
+    (min(position, (uint16_t)DIMMER_FULL) + 0x80) >> 8];
+  const byte level = bottom + ((int)(top - bottom) * eased + (top >= bottom ? 127 : -127)) / 255;
+  return GAMMA.level[level];
+}
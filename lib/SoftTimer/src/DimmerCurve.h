@@ -0,0 +1,99 @@
+/**
+ * File: DimmerCurve.h
+ * Description:
+ * SoftTimer library is a lightweight but effective event based timeshare solution for Arduino.
+ *
+ * Copying permission statement:
+    This file is part of SoftTimer.
+
+    SoftTimer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef DIMMERCURVE_H
+#define DIMMERCURVE_H
+
+#include "Arduino.h"
+#include "CompileTime.h"
+
+/**
+ * The position of a dimmer is a Q8.8 fixed point number: 8 integer and 8 fraction bits. It runs from 0 (off) to
+ * DIMMER_FULL (255.0, on), so a step of 255 / stepCount is kept without rounding errors adding up.
+ */
+#define DIMMER_FULL 0xFF00u
+
+/**
+ * The curve of the brightness along the dimming, in perceived brightness (the gamma correction is applied after).
+ */
+enum DimmerEasing : byte
+{
+  /** Even change of the brightness. */
+  DIMMER_EASE_LINEAR = 0,
+  /** Slow near off, fast near on. */
+  DIMMER_EASE_IN = 1,
+  /** Fast near off, slow near on. */
+  DIMMER_EASE_OUT = 2,
+  /** Slow near both ends: a soft pulsation. */
+  DIMMER_EASE_IN_OUT = 3,
+  DIMMER_EASINGS = 4
+};
+
+struct DimmerCurveTable
+{
+  byte level[256];
+};
+
+namespace DimmerCurve {
+  using CompileTime::Indices;
+  using CompileTime::MakeIndices;
+
+  constexpr double ease(DimmerEasing easing, double u) {
+    return easing == DIMMER_EASE_IN ? u * u
+      : easing == DIMMER_EASE_OUT ? u * (2.0 - u)
+      : easing == DIMMER_EASE_IN_OUT ? u * u * (3.0 - 2.0 * u)
+      : u;
+  }
+
+  constexpr double cube(double x) {
+    return x * x * x;
+  }
+
+  /** Luminance of the perceived brightness (CIE 1931 lightness, 0..1 both). */
+  constexpr double luminance(double lightness) {
+    return lightness <= 0.08 ? lightness * 100.0 / 903.3 : cube((lightness * 100.0 + 16.0) / 116.0);
+  }
+
+  constexpr byte toByte(double x) {
+    return byte(x * 255.0 + 0.5);
+  }
+
+  template<size_t... I>
+  constexpr DimmerCurveTable easingTable(DimmerEasing easing, Indices<I...>) {
+    return DimmerCurveTable{{ toByte(ease(easing, I / 255.0))... }};
+  }
+
+  template<size_t... I>
+  constexpr DimmerCurveTable gammaTable(Indices<I...>) {
+    return DimmerCurveTable{{ toByte(luminance(I / 255.0))... }};
+  }
+
+  /**
+   * The PWM duty (0 - 255) of the position (0 - DIMMER_FULL): the eased position between the bottom and the top
+   * perceived brightness, gamma corrected. A lookup in two tables computed by the compiler, integers only.
+   */
+  byte duty(uint16_t position, DimmerEasing easing, byte bottom = 0, byte top = 255);
+}
+
+#endif
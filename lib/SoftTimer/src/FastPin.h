@@ -0,0 +1,149 @@
+/**
+ * File: FastPin.h
+ * Description:
+ * SoftTimer library is a lightweight but effective event based timeshare solution for Arduino.
+ *
+ * Copying permission statement:
+    This file is part of SoftTimer.
+
+    SoftTimer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef FASTPIN_H
+#define FASTPIN_H
+
+#include <Arduino.h>
+
+/**
+ * Direct pin access for the output tasks. Both pin types have the same interface, so the tasks can be written once
+ * for both:
+ *  FastPin<PIN> - The port and the mask are resolved at compile time, on the SAMD21 a pin change is a single store to
+ *   the OUTSET / OUTCLR / OUTTGL register of the single-cycle I/O bus.
+ *  RuntimePin - The pin is given at run time, the port and the mask are looked up once by the constructor, a pin
+ *   change is still a single store.
+ * On other architectures both fall back to digitalWrite() / digitalRead().
+ */
+
+#if defined(ARDUINO_ARCH_SAMD)
+
+#if defined(ARDUINO_SAMD_NANO_33_IOT)
+namespace FastPinMap {
+  /** Port group (0 = PA, 1 = PB) and bit of the digital pins D0..D13, A0..A7 (variants/nano_33_iot/variant.cpp). */
+  static constexpr uint8_t PORTS[] = {
+    1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 1, 0, 0, 1, 1, 0, 1
+  };
+  static constexpr uint8_t BITS[] = {
+    23, 22, 10, 11, 7, 5, 4, 6, 18, 20, 21, 16, 19, 17,
+    2, 2, 11, 10, 8, 9, 9, 3
+  };
+  static constexpr uint8_t PINS = sizeof(BITS);
+}
+#endif
+
+template<uint8_t PIN>
+class FastPin
+{
+  public:
+    static void output() { pinMode(PIN, OUTPUT); }
+    static void input(uint8_t mode = INPUT) { pinMode(PIN, mode); }
+
+    static void high() { group()->OUTSET.reg = mask(); }
+    static void low() { group()->OUTCLR.reg = mask(); }
+    static void toggle() { group()->OUTTGL.reg = mask(); }
+    static void write(bool level) { if(level) { high(); } else { low(); } }
+    static bool read() { return group()->IN.reg & mask(); }
+
+    static constexpr uint8_t number() { return PIN; }
+
+  private:
+#if defined(ARDUINO_SAMD_NANO_33_IOT)
+    static_assert(PIN < FastPinMap::PINS, "FastPin: not a digital pin of the board");
+
+    static PortGroup* group() { return &PORT_IOBUS->Group[FastPinMap::PORTS[PIN]]; }
+    static constexpr uint32_t mask() { return 1ul << FastPinMap::BITS[PIN]; }
+#else
+    // -- The pin map of the board is not known at compile time.
+    static PortGroup* group() { return &PORT_IOBUS->Group[g_APinDescription[PIN].ulPort]; }
+    static uint32_t mask() { return 1ul << g_APinDescription[PIN].ulPin; }
+#endif
+};
+
+class RuntimePin
+{
+  public:
+    RuntimePin(uint8_t pin)
+      : _pin(pin),
+        _group(&PORT_IOBUS->Group[g_APinDescription[pin].ulPort]),
+        _mask(1ul << g_APinDescription[pin].ulPin) {}
+
+    void output() const { pinMode(this->_pin, OUTPUT); }
+    void input(uint8_t mode = INPUT) const { pinMode(this->_pin, mode); }
+
+    void high() const { this->_group->OUTSET.reg = this->_mask; }
+    void low() const { this->_group->OUTCLR.reg = this->_mask; }
+    void toggle() const { this->_group->OUTTGL.reg = this->_mask; }
+    void write(bool level) const { if(level) { this->high(); } else { this->low(); } }
+    bool read() const { return this->_group->IN.reg & this->_mask; }
+
+    uint8_t number() const { return this->_pin; }
+
+  private:
+    uint8_t _pin;
+    PortGroup* _group;
+    uint32_t _mask;
+};
+
+#else
+
+template<uint8_t PIN>
+class FastPin
+{
+  public:
+    static void output() { pinMode(PIN, OUTPUT); }
+    static void input(uint8_t mode = INPUT) { pinMode(PIN, mode); }
+
+    static void high() { digitalWrite(PIN, HIGH); }
+    static void low() { digitalWrite(PIN, LOW); }
+    static void toggle() { digitalWrite(PIN, !digitalRead(PIN)); }
+    static void write(bool level) { digitalWrite(PIN, level ? HIGH : LOW); }
+    static bool read() { return digitalRead(PIN) == HIGH; }
+
+    static constexpr uint8_t number() { return PIN; }
+};
+
+class RuntimePin
+{
+  public:
+    RuntimePin(uint8_t pin) : _pin(pin) {}
+
+    void output() const { pinMode(this->_pin, OUTPUT); }
+    void input(uint8_t mode = INPUT) const { pinMode(this->_pin, mode); }
+
+    void high() const { digitalWrite(this->_pin, HIGH); }
+    void low() const { digitalWrite(this->_pin, LOW); }
+    void toggle() const { digitalWrite(this->_pin, !digitalRead(this->_pin)); }
+    void write(bool level) const { digitalWrite(this->_pin, level ? HIGH : LOW); }
+    bool read() const { return digitalRead(this->_pin) == HIGH; }
+
+    uint8_t number() const { return this->_pin; }
+
+  private:
+    uint8_t _pin;
+};
+
+#endif
+
+#endif
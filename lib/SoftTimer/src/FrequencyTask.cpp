@@ -27,19 +27,18 @@
 #include "SoftTimer.h"
 #include "FrequencyTask.h"
 
-FrequencyTask::FrequencyTask(int outPin, float freq) : Task(0, &(FrequencyTask::step))
+FrequencyTask::FrequencyTask(int outPin, float freq) : FrequencyTask(outPin, freq, &(FrequencyTask::step))
 {
-  this->_outPin = outPin;
+}
 
-  _bitMask = digitalPinToBitMask(outPin);
-  _portRegister = portOutputRegister(digitalPinToPort(outPin));
-  
+FrequencyTask::FrequencyTask(int outPin, float freq, void (*callback)(Task* me)) : Task(0, callback), _pin(outPin)
+{
   this->setFrequency(freq);
 }
 
 void FrequencyTask::init()
 {
-  pinMode(this->_outPin, OUTPUT);
+  this->_pin.output();
   
   Task::init();
 }
@@ -53,12 +52,6 @@ void FrequencyTask::step(Task* task)
   FrequencyTask* ft = (FrequencyTask*)task;
   
   // -- Invert state.
-  if(ft->_stateOn) {
-      *ft->_portRegister &= ~ft->_bitMask;
-  } else {
-      *ft->_portRegister |= ft->_bitMask;
-  }
-  
-  ft->_stateOn = !ft->_stateOn;
+  ft->_pin.toggle();
 }
 
@@ -29,6 +29,7 @@
 
 #include "Task.h"
 #include "DelayRun.h"
+#include "FastPin.h"
 #include "Arduino.h"
 
 class FrequencyTask : public Task
@@ -47,19 +48,31 @@ class FrequencyTask : public Task
     /**
      * Adjust the frequency.
      */
-    void setFrequency(float freq);
-    
+    virtual void setFrequency(float freq);
+
+  protected:
+    /**
+     * For the subclasses that drive the pin by their own step callback.
+     */
+    FrequencyTask(int outPin, float freq, void (*callback)(Task* me));
+
   private:
-    int _outPin;
-    boolean _stateOn;
-    uint8_t _bitMask;
-//#ifndef ESP8266
-//    volatile uint8_t *_portRegister;
-//#else
-volatile uint32_t *_portRegister;
-//#endif
+    RuntimePin _pin;
     static void step(Task* me);
 };
 
+/**
+ * FrequencyTask on a pin known at compile time, e.g. FastFrequencyTask<9>. A step toggles the pin by a single store.
+ */
+template<uint8_t PIN>
+class FastFrequencyTask : public FrequencyTask
+{
+  public:
+    FastFrequencyTask(float freq) : FrequencyTask(PIN, freq, &(FastFrequencyTask::step)) {}
+
+  private:
+    static void step(Task*) { FastPin<PIN>::toggle(); }
+};
+
 #endif
 
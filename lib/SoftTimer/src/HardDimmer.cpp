@@ -28,10 +28,18 @@
 #include "HardDimmer.h"
 
 HardDimmer::HardDimmer(int pwmPin, int frequencyMs) : Task(10, &(HardDimmer::step))
+#if defined(ARDUINO_ARCH_SAMD)
+  , _channel(pwmPin)
+#endif
 {
   this->_pwmPin = pwmPin;
   this->direction = DIMMER_DIRECTION_HIGH;
   this->value = 0;
+  this->easing = DIMMER_EASE_LINEAR;
+#if defined(ARDUINO_ARCH_SAMD)
+  // -- analogWrite() of a pin without a timer channel just sets it HIGH or LOW.
+  this->_hardware = (g_APinDescription[pwmPin].ulPinAttribute & PIN_ATTR_PWM) == PIN_ATTR_PWM;
+#endif
   pinMode(this->_pwmPin, OUTPUT);
   this->stepCount = DEFAULT_STEP_COUNT;
 
@@ -41,7 +49,7 @@ HardDimmer::HardDimmer(int pwmPin, int frequencyMs) : Task(10, &(HardDimmer::ste
 
 void HardDimmer::startPulsate() {
   this->stopOnLimit = false;
-  analogWrite(this->_pwmPin, (int)this->value);
+  this->write(DimmerCurve::duty(this->value, this->easing, this->_bottomLevel, this->_topLevel));
   SoftTimer.add(this);
 }
 
@@ -51,8 +59,10 @@ void HardDimmer::hold() {
 
 void HardDimmer::off() {
   this->hold();
-  digitalWrite(this->_pwmPin, LOW);
-  SoftTimer.remove(this);
+  // -- A digitalWrite() would not reach the pin while it is connected to the timer.
+  this->write(0);
+  this->value = 0;
+  this->direction = DIMMER_DIRECTION_HIGH;
 }
 
 void HardDimmer::revertDirection() {
@@ -60,8 +70,8 @@ void HardDimmer::revertDirection() {
 }
 
 void HardDimmer::setFrequency(int frequencyMs) {
-  this->_stepLevel = (float)(this->_topLevel - this->_bottomLevel) / (float)this->stepCount;
-  this->periodMicros = (float)frequencyMs * 500.0 / (float)this->stepCount;
+  this->_stepLevel = DIMMER_FULL / this->stepCount;
+  this->periodMicros = (unsigned long)frequencyMs * 500 / this->stepCount;
   /*
   Serial.print("Dimmer");
   Serial.print(this->_pwmPin);
@@ -76,6 +86,16 @@ byte HardDimmer::getUpperLimit() {
   return 255;
 }
 
+void HardDimmer::write(byte duty) {
+#if defined(ARDUINO_ARCH_SAMD)
+  if(!this->_hardware) {
+    this->_channel.analogWrite(duty);
+    return;
+  }
+#endif
+  analogWrite(this->_pwmPin, duty);
+}
+
 
 void HardDimmer::step(Task* task)
 {
@@ -83,22 +103,23 @@ void HardDimmer::step(Task* task)
   
   boolean isOnLimit = false;
   
-  dimmer->value += dimmer->direction * dimmer->_stepLevel;
-  if((dimmer->direction < 0) && (dimmer->value < dimmer->_bottomLevel)) {
-    dimmer->value = dimmer->_bottomLevel;
+  int32_t value = (int32_t)dimmer->value + dimmer->direction * (int32_t)dimmer->_stepLevel;
+  if((dimmer->direction < 0) && (value <= 0)) {
+    value = 0;
     dimmer->direction *= -1; // -- next time go in the other direction
     isOnLimit = true;
-  } else if((dimmer->direction > 0) && (dimmer->value > dimmer->_topLevel)) {
-    dimmer->value = dimmer->_topLevel;
+  } else if((dimmer->direction > 0) && (value >= (int32_t)DIMMER_FULL)) {
+    value = DIMMER_FULL;
     dimmer->direction *= -1; // -- next time go in the other direction
     isOnLimit = true;
   }
+  dimmer->value = value;
   
   // Serial.print("Dimmer");
   // Serial.print(dimmer->_pwmPin);
   // Serial.print(" = ");
-  // Serial.println((int)dimmer->value);
-  analogWrite(dimmer->_pwmPin, (int)dimmer->value);
+  // Serial.println(dimmer->value);
+  dimmer->write(DimmerCurve::duty(dimmer->value, dimmer->easing, dimmer->_bottomLevel, dimmer->_topLevel));
   
   if(isOnLimit && dimmer->stopOnLimit) {
     SoftTimer.remove(dimmer);
@@ -29,6 +29,8 @@
 
 #include "Task.h"
 #include "SoftPwmTask.h"
+#include "SoftPwmChannel.h"
+#include "DimmerCurve.h"
 #include "Arduino.h"
 
 #define DIMMER_DIRECTION_HIGH 1
@@ -39,6 +41,7 @@
 /**
  * HardDimmer should be a drop in replacement for Dimmer,
  * except for the constructor.
+ * The pin is driven by analogWrite(), on the SAMD21 by a SoftPwmChannel if the pin has no hardware PWM.
  */
 class HardDimmer : public Task
 {
@@ -80,6 +83,9 @@ class HardDimmer : public Task
      */
     byte getUpperLimit();
     
+    /**
+     * The perceived brightness (0 - 255) at the ends of the dimming, before the gamma correction.
+     */
     void setBottomLevel(byte value = 0) 
     {
       this->_bottomLevel = value;
@@ -90,9 +96,15 @@ class HardDimmer : public Task
     }
    
     /**
-     * Current dim level PWM value. Note that the value should be between bottomLevel and topLevel.
+     * Current position of the dimming in Q8.8 fixed point, between 0 (bottomLevel) and DIMMER_FULL (topLevel). The
+     * PWM value is the position on the easing curve between the two levels, gamma corrected.
+     */
+    uint16_t value;
+
+    /**
+     * The curve of the perceived brightness along the dimming, DIMMER_EASE_LINEAR by default.
      */
-    float value;
+    DimmerEasing easing;
     
     /**
      * Stop if zero, or pwm->upperLimit is reached.
@@ -102,7 +114,7 @@ class HardDimmer : public Task
     /**
      * Can be one of DIMMER_DIRECTION_HIGH or DIMMER_DIRECTION_LOW.
      */
-    char direction;
+    int8_t direction;
     
     /**
      * Level-arranging steps should be performed within each full OFF->ON change. Will be applied if setFrequency() is called.
@@ -111,10 +123,15 @@ class HardDimmer : public Task
      
   private:
     int _pwmPin;
-    float _stepLevel;
+    uint16_t _stepLevel;
     static void step(Task* me);
-    float _topLevel = 255;
-    float _bottomLevel = 0;
+    void write(byte duty);
+    byte _topLevel = 255;
+    byte _bottomLevel = 0;
+#if defined(ARDUINO_ARCH_SAMD)
+    bool _hardware;
+    SoftPwmChannel _channel;
+#endif
 };
 
 #endif
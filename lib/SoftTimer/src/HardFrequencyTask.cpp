@@ -0,0 +1,207 @@
+/**
+ * File: HardFrequencyTask.cpp
+ * Description:
+ * SoftTimer library is a lightweight but effective event based timeshare solution for Arduino.
+ *
+ * Copying permission statement:
+    This file is part of SoftTimer.
+
+    SoftTimer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "SoftTimer.h"
+#include "HardFrequencyTask.h"
+
+#if defined(ARDUINO_ARCH_SAMD)
+#include "wiring_private.h"
+#endif
+
+HardFrequencyTask::HardFrequencyTask(int outPin, float freq) : FrequencyTask(outPin, freq)
+{
+  this->_outPin = outPin;
+  this->_freq = freq;
+  this->_running = false;
+  this->_hardware = false;
+#if defined(ARDUINO_ARCH_SAMD)
+  const PinDescription& pinDesc = g_APinDescription[outPin];
+  if((pinDesc.ulPinAttribute & PIN_ATTR_PWM) == PIN_ATTR_PWM) {
+    this->_timer = GetTCNumber(pinDesc.ulPWMChannel);
+    this->_channel = GetTCChannelNumber(pinDesc.ulPWMChannel);
+  }
+  else {
+    this->_timer = NO_TIMER;
+    this->_channel = 0;
+  }
+#endif
+}
+
+void HardFrequencyTask::start()
+{
+  this->_running = true;
+  if(this->_hardware) {
+    this->program();
+    return;
+  }
+  if(this->timerFree()) {
+    // -- It may have been running on the scheduler.
+    SoftTimer.remove(this);
+#if defined(ARDUINO_ARCH_SAMD)
+    // -- Just like analogWrite() does.
+    const uint32_t attr = g_APinDescription[this->_outPin].ulPinAttribute;
+    pinPeripheral(this->_outPin, (attr & PIN_ATTR_TIMER) ? PIO_TIMER : PIO_TIMER_ALT);
+#endif
+    this->_hardware = true;
+    this->program();
+    return;
+  }
+  SoftTimer.add(this);
+}
+
+void HardFrequencyTask::stop()
+{
+  if(this->_hardware) {
+#if defined(ARDUINO_ARCH_SAMD)
+    if(this->_timer < TCC_INST_NUM) {
+      Tcc* tcc = (Tcc*)g_apTCInstances[this->_timer];
+      tcc->CTRLA.bit.ENABLE = 0;
+      while(tcc->SYNCBUSY.bit.ENABLE);
+    }
+    else {
+      TcCount16* tc = (TcCount16*)g_apTCInstances[this->_timer];
+      tc->CTRLA.bit.ENABLE = 0;
+      while(tc->STATUS.bit.SYNCBUSY);
+    }
+#else
+    noTone(this->_outPin);
+#endif
+    this->_hardware = false;
+  }
+  else if(this->_running) {
+    SoftTimer.remove(this);
+  }
+  this->_running = false;
+
+  // -- Takes the pin back from the timer.
+  pinMode(this->_outPin, OUTPUT);
+  digitalWrite(this->_outPin, LOW);
+}
+
+void HardFrequencyTask::setFrequency(float freq)
+{
+  this->_freq = freq;
+  FrequencyTask::setFrequency(freq);
+  if(this->_hardware) {
+    this->program();
+  }
+}
+
+#if defined(ARDUINO_ARCH_SAMD)
+
+bool HardFrequencyTask::timerFree() const
+{
+  if(this->_timer == NO_TIMER) {
+    return false;
+  }
+  // -- A running timer belongs to someone else, it is not touched.
+  if(this->_timer < TCC_INST_NUM) {
+    return !((Tcc*)g_apTCInstances[this->_timer])->CTRLA.bit.ENABLE;
+  }
+  return !((TcCount16*)g_apTCInstances[this->_timer])->CTRLA.bit.ENABLE;
+}
+
+void HardFrequencyTask::program()
+{
+  static const uint16_t CLOCK_IDS[] = {
+    GCLK_CLKCTRL_ID_TCC0_TCC1, GCLK_CLKCTRL_ID_TCC0_TCC1, GCLK_CLKCTRL_ID_TCC2_TC3,
+    GCLK_CLKCTRL_ID_TCC2_TC3, GCLK_CLKCTRL_ID_TC4_TC5, GCLK_CLKCTRL_ID_TC4_TC5
+  };
+  static const byte SHIFTS[] = { 0, 1, 2, 3, 4, 6, 8, 10 };
+
+  // -- The same 48 MHz clock as analogWrite() gives the timer.
+  GCLK->CLKCTRL.reg = (uint16_t)(GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK0 | CLOCK_IDS[this->_timer]);
+  while(GCLK->STATUS.bit.SYNCBUSY);
+
+  // -- Clock cycles of a whole wave.
+  const uint32_t cycle = (uint32_t)(F_CPU / this->_freq + 0.5f);
+
+  if(this->_timer < TCC_INST_NUM) {
+    // -- TCC0 and TCC1 have a 24 bit counter, TCC2 a 16 bit one.
+    const uint32_t limit = (this->_timer == 2) ? 0x10000ul : 0x1000000ul;
+    byte prescaler = 0;
+    while((prescaler < sizeof(SHIFTS) - 1) && ((cycle >> SHIFTS[prescaler]) > limit)) {
+      prescaler++;
+    }
+    const uint32_t ticks = constrain(cycle >> SHIFTS[prescaler], 2ul, limit);
+
+    // -- A 50% PWM with the wave as its period, all channels of the TCC run with the same period.
+    Tcc* tcc = (Tcc*)g_apTCInstances[this->_timer];
+    tcc->CTRLA.bit.ENABLE = 0;
+    while(tcc->SYNCBUSY.bit.ENABLE);
+    tcc->CTRLA.reg = TCC_CTRLA_PRESCALER(prescaler);
+    tcc->WAVE.reg = TCC_WAVE_WAVEGEN_NPWM;
+    while(tcc->SYNCBUSY.bit.WAVE);
+    tcc->PER.reg = ticks - 1;
+    while(tcc->SYNCBUSY.bit.PER);
+    tcc->CC[this->_channel].reg = ticks / 2;
+    while(tcc->SYNCBUSY.reg & TCC_SYNCBUSY_MASK);
+    tcc->CTRLA.bit.ENABLE = 1;
+    while(tcc->SYNCBUSY.bit.ENABLE);
+  }
+  else {
+    // -- WO[0] toggles on each CC0 match in MFRQ mode, so the counter runs half waves. WO[1] is a 50% PWM with CC0 as
+    // -- its top.
+    const uint32_t wave = (this->_channel == 0) ? cycle / 2 : cycle;
+    byte prescaler = 0;
+    while((prescaler < sizeof(SHIFTS) - 1) && ((wave >> SHIFTS[prescaler]) > 0x10000)) {
+      prescaler++;
+    }
+    const uint32_t ticks = constrain(wave >> SHIFTS[prescaler], 2ul, 0x10000ul);
+
+    TcCount16* tc = (TcCount16*)g_apTCInstances[this->_timer];
+    tc->CTRLA.bit.ENABLE = 0;
+    while(tc->STATUS.bit.SYNCBUSY);
+    if(this->_channel == 0) {
+      tc->CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_WAVEGEN_MFRQ | TC_CTRLA_PRESCALER(prescaler);
+      while(tc->STATUS.bit.SYNCBUSY);
+    }
+    else {
+      tc->CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_WAVEGEN_MPWM | TC_CTRLA_PRESCALER(prescaler);
+      while(tc->STATUS.bit.SYNCBUSY);
+      tc->CC[1].reg = ticks / 2;
+      while(tc->STATUS.bit.SYNCBUSY);
+    }
+    tc->CC[0].reg = ticks - 1;
+    while(tc->STATUS.bit.SYNCBUSY);
+    tc->COUNT.reg = 0;
+    while(tc->STATUS.bit.SYNCBUSY);
+    tc->CTRLA.bit.ENABLE = 1;
+    while(tc->STATUS.bit.SYNCBUSY);
+  }
+}
+
+#else
+
+bool HardFrequencyTask::timerFree() const
+{
+  return true;
+}
+
+void HardFrequencyTask::program()
+{
+  tone(this->_outPin, (unsigned int)(this->_freq + 0.5f));
+}
+
+#endif
@@ -0,0 +1,86 @@
+/**
+ * File: HardFrequencyTask.h
+ * Description:
+ * SoftTimer library is a lightweight but effective event based timeshare solution for Arduino.
+ *
+ * Copying permission statement:
+    This file is part of SoftTimer.
+
+    SoftTimer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef HARDFREQUENCYTASK_H
+#define HARDFREQUENCYTASK_H
+
+#include "FrequencyTask.h"
+#include "Arduino.h"
+
+/**
+ * HardFrequencyTask should be a drop in replacement for FrequencyTask, except that it is switched by start() and
+ * stop() instead of adding it to and removing it from the SoftTimer.
+ * On the SAMD21 the square wave is generated by the TCC/TC channel of the pin in waveform mode: the frequency is exact
+ * and costs no CPU. If the pin has no timer channel, or the timer is already running (analogWrite(), Servo, tone(),
+ * SoftPwmEngine or another HardFrequencyTask), start() falls back to the FrequencyTask: the pin is toggled by the
+ * scheduler. On other architectures the wave is generated by tone().
+ */
+class HardFrequencyTask : public FrequencyTask
+{
+  public:
+    /**
+     * Initialize a frequency generator on the pin with the given initial frequency value.
+     *  outPin - The digital pin of the output.
+     *  freq - Initial frequency.
+     */
+    HardFrequencyTask(int outPin, float freq);
+
+    /**
+     * Starts the output, on the timer of the pin if it is free, otherwise by registering the task to the timer
+     * manager. Restarts it with the current frequency if it is running.
+     */
+    void start();
+
+    /**
+     * Stops the output and sets the pin to LOW.
+     */
+    void stop();
+
+    /**
+     * Adjust the frequency, also of the running output.
+     */
+    void setFrequency(float freq) override;
+
+    /**
+     * The output is running on a hardware timer.
+     */
+    bool hardware() const { return this->_hardware; }
+
+  private:
+    bool timerFree() const;
+    void program();
+
+    int _outPin;
+    float _freq;
+    bool _running;
+    bool _hardware;
+#if defined(ARDUINO_ARCH_SAMD)
+    // -- TCC0, TCC1, TCC2, TC3, TC4, TC5 as in g_apTCInstances, NO_TIMER if the pin has no timer channel.
+    static const byte NO_TIMER = 0xFF;
+    byte _timer;
+    byte _channel;
+#endif
+};
+
+#endif
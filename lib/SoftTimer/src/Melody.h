@@ -0,0 +1,131 @@
+/**
+ * File: Melody.h
+ * Description:
+ * SoftTimer library is a lightweight but effective event based timeshare solution for Arduino.
+ *
+ * Copying permission statement:
+    This file is part of SoftTimer.
+
+    SoftTimer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef MELODY_H
+#define MELODY_H
+
+#include "Arduino.h"
+#include "CompileTime.h"
+
+/**
+ * Half tones of the lowest and the highest note of the frequency table from A4 (440 Hz): A0 and C8, the keys of a
+ * piano. A tuned note outside is played as the nearest end.
+ */
+#define MELODY_LOWEST -48
+#define MELODY_HIGHEST 39
+
+/**
+ * Half tones of the silence.
+ */
+#define MELODY_REST INT8_MIN
+
+/**
+ * A note of a compiled melody.
+ */
+struct MelodyNote
+{
+  /** Half tones from A4, or MELODY_REST. */
+  int8_t halfTones;
+  /** Multiplier of the base length of the player. */
+  uint8_t length;
+};
+
+/**
+ * A melody compiled by compileMelody(). Declared as a static constexpr the notes stay in the flash.
+ */
+template<size_t N>
+struct Melody
+{
+  MelodyNote notes[N];
+};
+
+/**
+ * The frequencies of the half tones between MELODY_LOWEST and MELODY_HIGHEST.
+ */
+struct MelodyFrequencies
+{
+  float hz[MELODY_HIGHEST - MELODY_LOWEST + 1];
+};
+
+namespace MelodyCompiler {
+  using CompileTime::Indices;
+  using CompileTime::MakeIndices;
+
+  /**
+   * Not constexpr: compileMelody() of a melody that calls them does not compile, that is the error message. Played
+   * from text an invalid note is a silence, an invalid length is 0.
+   */
+  inline int8_t invalidNoteCharacter() { return MELODY_REST; }
+  inline uint8_t invalidLengthCharacter() { return 0; }
+
+  /**
+   * The note markers of TonePlayer::play(): 'j' is A4, the letters in alphabetic order are the half tones, 'Z' is
+   * followed by 'a'. '_' is the silence.
+   */
+  constexpr int8_t halfTones(char c) {
+    return c == '_' ? MELODY_REST
+      : (c >= 'a' && c <= 'z') ? int8_t(c - 'j')
+      : (c >= 'A' && c <= 'Z') ? int8_t(c - 'j' + 6)
+      : invalidNoteCharacter();
+  }
+
+  constexpr uint8_t length(char c) {
+    return (c >= '0' && c <= '9') ? uint8_t(c - '0') : invalidLengthCharacter();
+  }
+
+  /** The index-th note of the text form. */
+  constexpr MelodyNote note(const char* tones, size_t index) {
+    return MelodyNote{ halfTones(tones[2 * index]), length(tones[2 * index + 1]) };
+  }
+
+  template<size_t N, size_t... I>
+  constexpr Melody<sizeof...(I)> compile(const char (&tones)[N], Indices<I...>) {
+    return Melody<sizeof...(I)>{{ note(tones, I)... }};
+  }
+
+  /** 440 Hz multiplied by the twelfth root of two for each half tone. */
+  constexpr double frequency(int halfTones) {
+    return halfTones == 0 ? 440.0
+      : halfTones > 0 ? frequency(halfTones - 1) * 1.05946309435929
+      : frequency(halfTones + 1) / 1.05946309435929;
+  }
+
+  template<size_t... I>
+  constexpr MelodyFrequencies frequencies(Indices<I...>) {
+    return MelodyFrequencies{{ float(frequency(int(I) + MELODY_LOWEST))... }};
+  }
+}
+
+/**
+ * Compiles the text form of TonePlayer::play() to notes, e.g.
+ *   static constexpr auto welcome = compileMelody("e1f1h2h1m2h2");
+ * A character that is not a note marker or a length digit is a compile error.
+ */
+template<size_t N>
+constexpr Melody<(N - 1) / 2> compileMelody(const char (&tones)[N]) {
+  static_assert((N > 1) && ((N - 1) % 2 == 0), "compileMelody: a melody is pairs of a note marker and a length");
+  return MelodyCompiler::compile(tones, typename MelodyCompiler::MakeIndices<(N - 1) / 2>::type());
+}
+
+#endif
@@ -0,0 +1,69 @@
+/**
+ * File: SoftPwmChannel.cpp
+ * Description:
+ * SoftTimer library is a lightweight but effective event based timeshare solution for Arduino.
+ *
+ * Copying permission statement:
+    This file is part of SoftTimer.
+
+    SoftTimer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "SoftPwmChannel.h"
+
+#if defined(ARDUINO_ARCH_SAMD)
+
+SoftPwmChannel::SoftPwmChannel(int pin) : SoftPwmTask(pin, &(SoftPwmChannel::idle))
+{
+  this->_port = g_APinDescription[pin].ulPort;
+  this->_mask = 1ul << g_APinDescription[pin].ulPin;
+  this->_level = 0;
+  this->_attached = false;
+  // -- Nothing to do, if it was added to the SoftTimer, it should not take a scheduler slot too often.
+  this->setPeriodMs(1000);
+}
+
+void SoftPwmChannel::init() {
+  this->attach();
+}
+
+void SoftPwmChannel::analogWrite(byte value) {
+  this->attach();
+  this->_level = value;
+  SoftPwmEngine.update();
+}
+
+void SoftPwmChannel::off() {
+  this->analogWrite(0);
+}
+
+void SoftPwmChannel::setFrequency(unsigned long freq) {
+  SoftPwmEngine.setFrequency(freq);
+}
+
+void SoftPwmChannel::attach() {
+  if(this->_attached) {
+    return;
+  }
+  // -- Sets the pin to output.
+  SoftPwmTask::init();
+  this->_attached = SoftPwmEngine.attach(this);
+}
+
+void SoftPwmChannel::idle(Task* me) {
+}
+
+#endif
@@ -0,0 +1,89 @@
+/**
+ * File: SoftPwmChannel.h
+ * Description:
+ * SoftTimer library is a lightweight but effective event based timeshare solution for Arduino.
+ *
+ * Copying permission statement:
+    This file is part of SoftTimer.
+
+    SoftTimer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef SOFTPWMCHANNEL_H
+#define SOFTPWMCHANNEL_H
+
+#include "SoftPwmTask.h"
+#include "SoftPwmEngine.h"
+#include "Arduino.h"
+
+#if defined(ARDUINO_ARCH_SAMD)
+
+/**
+ * A PWM output of the SoftPwmEngine: a drop-in for the SoftPwmTask, with the same analogWrite(), off() and upperLimit,
+ * but the pin is driven by the TC3 interrupt instead of a scheduler task. A channel does not need to be added to the
+ * SoftTimer, it is attached to the engine by its first init() or analogWrite(). It may still be added (e.g. by the
+ * Dimmer), the task itself has nothing to do.
+ * Channels are expected to live as long as the sketch (global objects), they are never detached.
+ */
+class SoftPwmChannel : public SoftPwmTask
+{
+  friend class SoftPwmEngineClass;
+
+  public:
+    SoftPwmChannel(int pin);
+
+    void init() override;
+
+    /**
+     * Sets the duty level, the change is seen from the start of the next PWM cycle.
+     *  value - The duty cycle: between 0 (always off (LOW)) and upperLimit (always on (HIGH)).
+     */
+    void analogWrite(byte value) override;
+
+    /**
+     * Turns the output to low: the duty level is set to 0.
+     */
+    void off() override;
+
+    /**
+     * Sets the PWM frequency of the engine, that is of all channels.
+     */
+    void setFrequency(unsigned long freq);
+
+  private:
+    void attach();
+    static void idle(Task* me);
+
+    byte _port;
+    uint32_t _mask;
+    byte _level;
+    bool _attached;
+};
+
+#else
+
+/**
+ * There is no engine on this architecture, the channel is a SoftPwmTask: add it to the SoftTimer.
+ */
+class SoftPwmChannel : public SoftPwmTask
+{
+  public:
+    SoftPwmChannel(int pin) : SoftPwmTask(pin) {}
+};
+
+#endif
+
+#endif
@@ -0,0 +1,229 @@
+/**
+ * File: SoftPwmEngine.cpp
+ * Description:
+ * SoftTimer library is a lightweight but effective event based timeshare solution for Arduino.
+ *
+ * Copying permission statement:
+    This file is part of SoftTimer.
+
+    SoftTimer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "SoftPwmEngine.h"
+
+#if defined(ARDUINO_ARCH_SAMD)
+
+#include <stddef.h>
+#include "SoftPwmChannel.h"
+
+SoftPwmEngineClass SoftPwmEngine;
+
+void TC3_Handler()
+{
+  SoftPwmEngine.handleInterrupt();
+}
+
+void SoftPwmEngineClass::begin(unsigned long freq) {
+  PM->APBCMASK.reg |= PM_APBCMASK_TC3;
+
+  // -- TC3 shares the generic clock with TCC2, analogWrite() runs that from GCLK0 (48 MHz) as well.
+  GCLK->CLKCTRL.reg = (uint16_t)(GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK0 | GCLK_CLKCTRL_ID_TCC2_TC3);
+  while(GCLK->STATUS.bit.SYNCBUSY);
+
+  // -- An edge must not wait for the other interrupts (e.g. the SysTick).
+  NVIC_SetPriority(TC3_IRQn, 0);
+
+  this->_started = true;
+  this->setFrequency(freq);
+}
+
+void SoftPwmEngineClass::setFrequency(unsigned long freq) {
+  if(!this->_started) {
+    this->begin(freq);
+    return;
+  }
+
+  TcCount16* tc = &TC3->COUNT16;
+
+  NVIC_DisableIRQ(TC3_IRQn);
+  tc->CTRLA.reg = TC_CTRLA_SWRST;
+  while(tc->CTRLA.bit.SWRST);
+
+  // -- The smallest prescaler with a cycle that fits into the 16 bit counter.
+  static const byte SHIFTS[] = { 0, 1, 2, 3, 4, 6, 8, 10 };
+  const uint32_t cycle = F_CPU / (freq ? freq : 1);
+  byte prescaler = 0;
+  while((prescaler < sizeof(SHIFTS) - 1) && ((cycle >> SHIFTS[prescaler]) > 0x10000)) {
+    prescaler++;
+  }
+  this->_ticks = constrain(cycle >> SHIFTS[prescaler], 2ul, 0x10000ul);
+  this->_gap = max<unsigned long>(1, (F_CPU >> SHIFTS[prescaler]) * SOFTPWM_MIN_GAP_US / 1000000ul);
+
+  tc->CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_WAVEGEN_MFRQ | TC_CTRLA_PRESCALER(prescaler);
+  while(tc->STATUS.bit.SYNCBUSY);
+  // -- The counter wraps after CC0: that is the start of the cycle.
+  tc->CC[0].reg = this->_ticks - 1;
+  while(tc->STATUS.bit.SYNCBUSY);
+  // -- COUNT is kept synchronized, so the interrupt can read it without a wait.
+  tc->READREQ.reg = TC_READREQ_RCONT | TC_READREQ_ADDR(TC_COUNT16_COUNT_OFFSET);
+  tc->INTFLAG.reg = TC_INTFLAG_MC0 | TC_INTFLAG_MC1;
+  tc->INTENSET.reg = TC_INTENSET_MC0;
+
+  // -- The interrupt is off, the active frame can be rebuilt for the new cycle length.
+  this->build(&this->_frames[this->_active]);
+  this->_pending = false;
+  this->_next = 0;
+
+  NVIC_ClearPendingIRQ(TC3_IRQn);
+  NVIC_EnableIRQ(TC3_IRQn);
+  tc->CTRLA.reg |= TC_CTRLA_ENABLE;
+  while(tc->STATUS.bit.SYNCBUSY);
+}
+
+bool SoftPwmEngineClass::attach(SoftPwmChannel* channel) {
+  if(this->_count >= SOFTPWM_CHANNELS_MAX) {
+    return false;
+  }
+  if(!this->_started) {
+    this->begin();
+  }
+  this->_channels[this->_count++] = channel;
+  return true;
+}
+
+void SoftPwmEngineClass::update() {
+  if(!this->_started) {
+    return;
+  }
+
+  Frame frame;
+  this->build(&frame);
+
+  // -- The interrupt may be taking the pending frame just now, it is held off for the copy (a few microseconds).
+  NVIC_DisableIRQ(TC3_IRQn);
+  memcpy(&this->_frames[this->_active ^ 1], &frame, offsetof(Frame, step) + frame.steps * sizeof(Step));
+  this->_pending = true;
+  NVIC_EnableIRQ(TC3_IRQn);
+}
+
+void SoftPwmEngineClass::build(Frame* frame) const {
+  struct Edge
+  {
+    uint16_t at;
+    byte port;
+    uint32_t mask;
+  };
+  Edge edges[SOFTPWM_CHANNELS_MAX];
+  byte count = 0;
+
+  memset(frame, 0, offsetof(Frame, step));
+
+  for(byte c = 0; c < this->_count; c++) {
+    const SoftPwmChannel* channel = this->_channels[c];
+    if(channel->_level == 0) {
+      frame->clear[channel->_port] |= channel->_mask;
+      continue;
+    }
+    frame->set[channel->_port] |= channel->_mask;
+    if(channel->_level >= channel->upperLimit) {
+      // -- Always on.
+      continue;
+    }
+
+    // -- The edge comes after the interrupt that starts the cycle, and before the counter wraps.
+    uint32_t at = (uint32_t)channel->_level * this->_ticks / channel->upperLimit;
+    at = constrain(at, (uint32_t)this->_gap, this->_ticks - this->_gap);
+
+    // -- Insertion sort, there are only a few of them.
+    byte i = count++;
+    while((i > 0) && (edges[i - 1].at > at)) {
+      edges[i] = edges[i - 1];
+      i--;
+    }
+    edges[i].at = at;
+    edges[i].port = channel->_port;
+    edges[i].mask = channel->_mask;
+  }
+
+  for(byte i = 0; i < count; i++) {
+    if((frame->steps == 0) || (edges[i].at - frame->step[frame->steps - 1].at >= this->_gap)) {
+      Step* step = &frame->step[frame->steps++];
+      step->at = edges[i].at;
+      memset(step->clear, 0, sizeof(step->clear));
+    }
+    // -- Too close to the previous edge: cleared by the same interrupt.
+    frame->step[frame->steps - 1].clear[edges[i].port] |= edges[i].mask;
+  }
+}
+
+void SoftPwmEngineClass::clear(const Step* step) {
+  PORT_IOBUS->Group[0].OUTCLR.reg = step->clear[0];
+  PORT_IOBUS->Group[1].OUTCLR.reg = step->clear[1];
+  this->_next++;
+}
+
+void SoftPwmEngineClass::arm(const Frame* frame) {
+  TcCount16* tc = &TC3->COUNT16;
+  // -- The synchronized COUNT is a few ticks behind, an edge this close counts as passed.
+  const uint16_t margin = this->_gap / 2;
+
+  while(this->_next < frame->steps) {
+    const Step* step = &frame->step[this->_next];
+    if(tc->COUNT.reg + margin < step->at) {
+      tc->INTFLAG.reg = TC_INTFLAG_MC1;
+      tc->CC[1].reg = step->at;
+      while(tc->STATUS.bit.SYNCBUSY);
+      // -- In time if the counter has not reached the edge while the compare value was synchronized.
+      if(tc->COUNT.reg + margin < step->at) {
+        tc->INTENSET.reg = TC_INTENSET_MC1;
+        return;
+      }
+    }
+    // -- Late (the interrupt was held off) or due: cleared right now.
+    this->clear(step);
+  }
+  tc->INTENCLR.reg = TC_INTENCLR_MC1;
+}
+
+void SoftPwmEngineClass::handleInterrupt() {
+  TcCount16* tc = &TC3->COUNT16;
+  const byte flags = tc->INTFLAG.reg & tc->INTENSET.reg;
+
+  // -- An edge of the cycle that has just ended is handled before the start of the next one.
+  if(flags & TC_INTFLAG_MC1) {
+    const Frame* frame = &this->_frames[this->_active];
+    tc->INTFLAG.reg = TC_INTFLAG_MC1;
+    this->clear(&frame->step[this->_next]);
+    this->arm(frame);
+  }
+
+  if(flags & TC_INTFLAG_MC0) {
+    tc->INTFLAG.reg = TC_INTFLAG_MC0;
+    if(this->_pending) {
+      this->_active ^= 1;
+      this->_pending = false;
+    }
+    const Frame* frame = &this->_frames[this->_active];
+    PORT_IOBUS->Group[0].OUTCLR.reg = frame->clear[0];
+    PORT_IOBUS->Group[1].OUTCLR.reg = frame->clear[1];
+    PORT_IOBUS->Group[0].OUTSET.reg = frame->set[0];
+    PORT_IOBUS->Group[1].OUTSET.reg = frame->set[1];
+    this->_next = 0;
+    this->arm(frame);
+  }
+}
+
+#endif
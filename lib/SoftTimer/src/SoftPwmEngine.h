@@ -0,0 +1,134 @@
+/**
+ * File: SoftPwmEngine.h
+ * Description:
+ * SoftTimer library is a lightweight but effective event based timeshare solution for Arduino.
+ *
+ * Copying permission statement:
+    This file is part of SoftTimer.
+
+    SoftTimer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef SOFTPWMENGINE_H
+#define SOFTPWMENGINE_H
+
+#include <Arduino.h>
+
+#if defined(ARDUINO_ARCH_SAMD)
+
+/**
+ * The most channels the engine drives.
+ */
+#define SOFTPWM_CHANNELS_MAX 16
+
+/**
+ * The PWM frequency of the channels if begin() was not called before the first channel was attached.
+ */
+#define SOFTPWM_DEFAULT_FREQUENCY 400
+
+/**
+ * Edges closer than this many microseconds are switched by the same interrupt.
+ */
+#define SOFTPWM_MIN_GAP_US 5
+
+class SoftPwmChannel;
+
+/**
+ * One TC3 interrupt drives the pins of all SoftPwmChannels. The cycle starts when the counter wraps: every channel
+ * with a non-zero duty is set HIGH, then the compare interrupt walks through a table of the falling edges sorted by
+ * time, clearing every channel whose duty has passed by a single store per port. A duty change builds a new table in
+ * the background, the interrupt switches to it at the start of the next cycle, so a cycle is never cut short or
+ * stretched by a change. The duty does not depend on the other tasks at all.
+ * The engine owns TC3: analogWrite() must not be used on the pins driven by TC3 while a channel is attached.
+ */
+class SoftPwmEngineClass
+{
+  public:
+    /**
+     * Starts the timer. Called by the first attached channel with SOFTPWM_DEFAULT_FREQUENCY, call it before that for
+     * another frequency.
+     *  freq - The PWM frequency of all channels, between 12 Hz and 20 kHz.
+     */
+    void begin(unsigned long freq = SOFTPWM_DEFAULT_FREQUENCY);
+
+    /**
+     * Sets the PWM frequency of all channels. The cycle running at the change may be cut short.
+     */
+    void setFrequency(unsigned long freq);
+
+    /**
+     * Adds the channel to the table. Returns false if all SOFTPWM_CHANNELS_MAX channels are in use.
+     */
+    bool attach(SoftPwmChannel* channel);
+
+    /**
+     * Builds the table of the current channel levels, the interrupt takes it at the start of the next cycle.
+     */
+    void update();
+
+    /**
+     * Number of the attached channels.
+     */
+    byte channels() const { return this->_count; }
+
+    /**
+     * The TC3 interrupt handler, not to be called otherwise.
+     */
+    void handleInterrupt();
+
+  private:
+    // -- PA and PB.
+    static const byte PORTS = 2;
+
+    struct Step
+    {
+      uint16_t at;
+      uint32_t clear[PORTS];
+    };
+
+    struct Frame
+    {
+      // -- Pins to set and to clear at the start of the cycle.
+      uint32_t set[PORTS];
+      uint32_t clear[PORTS];
+      byte steps;
+      Step step[SOFTPWM_CHANNELS_MAX];
+    };
+
+    void build(Frame* frame) const;
+    void arm(const Frame* frame);
+    void clear(const Step* step);
+
+    SoftPwmChannel* _channels[SOFTPWM_CHANNELS_MAX];
+    byte _count;
+    bool _started;
+    // -- Counter ticks of a cycle and of SOFTPWM_MIN_GAP_US.
+    uint32_t _ticks;
+    uint16_t _gap;
+
+    // -- The interrupt runs the active frame, update() writes the other one and marks it pending.
+    Frame _frames[2];
+    volatile byte _active;
+    volatile bool _pending;
+    // -- Index of the next step in the active frame.
+    volatile byte _next;
+};
+
+extern SoftPwmEngineClass SoftPwmEngine;
+
+#endif
+
+#endif
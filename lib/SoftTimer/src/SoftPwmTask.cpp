@@ -27,20 +27,20 @@
 #include "SoftTimer.h"
 #include "SoftPwmTask.h"
 
-SoftPwmTask::SoftPwmTask(int pin) : Task(0, &(SoftPwmTask::step))
+SoftPwmTask::SoftPwmTask(int pin) : SoftPwmTask(pin, &(SoftPwmTask::step))
+{
+}
+
+SoftPwmTask::SoftPwmTask(int pin, void (*callback)(Task* me)) : Task(0, callback), _pin(pin)
 {
-  _outPin = pin;
   _value = 0;
   _counter = 0;
   upperLimit = 255;
   this->periodMicros = 30;
-
-  _bitMask = digitalPinToBitMask(pin);
-  _portRegister = portOutputRegister(digitalPinToPort(pin));
 }
 
 void SoftPwmTask::init() {
-  pinMode(this->_outPin, OUTPUT);
+  this->_pin.output();
   Task::init();
 }
 
@@ -49,7 +49,7 @@ void SoftPwmTask::analogWrite(byte value) {
 }
 
 void SoftPwmTask::off() {
-  *this->_portRegister &= ~this->_bitMask;
+  this->_pin.low();
 }
 
 void SoftPwmTask::setFrequency(unsigned long freq) {
@@ -58,21 +58,5 @@ void SoftPwmTask::setFrequency(unsigned long freq) {
 
 void SoftPwmTask::step(Task* task)
 {
-  SoftPwmTask* spt = (SoftPwmTask*)task;
-  if(spt->_counter == spt->upperLimit) {
-    // -- Reached the upper limit.
-    if(spt->_value != 0) {
-      // -- Set to HIGH.
-      *spt->_portRegister |= spt->_bitMask;
-    }
-    spt->_counter = 0;
-  }
-  else {
-    if(spt->_counter >= spt->_value) {
-      // -- Reached the value level.
-      // -- Set to LOW.
-      *spt->_portRegister &= ~spt->_bitMask;
-    }
-    spt->_counter++;
-  }
+  SoftPwmTask::stepPin(task, ((SoftPwmTask*)task)->_pin);
 }
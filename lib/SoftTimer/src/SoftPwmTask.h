@@ -28,6 +28,7 @@
 #define SOFTPWMTASK_H
 
 #include "Task.h"
+#include "FastPin.h"
 #include "Arduino.h"
 
 class SoftPwmTask : public Task
@@ -44,12 +45,12 @@ class SoftPwmTask : public Task
      * Just like in the Arduino implementation this method will set the duty level of the pin.
      *  value - The duty cycle: between 0 (always off (LOW)) and upperLimit (always on (HIGH)).
      */
-    void analogWrite(byte value);
+    virtual void analogWrite(byte value);
     
     /**
      * Turns the output to low.
      */
-    void off();
+    virtual void off();
     
    /**
     * Sets the PWM frequency (count of ON-OFFs per second).
@@ -60,19 +61,60 @@ class SoftPwmTask : public Task
      * The "always on" level of the PWM. The default is 255.
      */
     byte upperLimit;
-    
+
+  protected:
+    /**
+     * For the subclasses that drive the pin by their own step callback.
+     */
+    SoftPwmTask(int pin, void (*callback)(Task* me));
+
+    /**
+     * One step of the PWM cycle on the pin, for both pin types of FastPin.h.
+     */
+    template<class Pin>
+    static void stepPin(Task* task, const Pin& pin);
+
   private:
-    int _outPin;
+    RuntimePin _pin;
     byte _value;
     byte _counter;
     static void step(Task* me);
-    
-    uint8_t _bitMask;
-//#ifndef ESP8266
-//    volatile uint8_t *_portRegister;
-//#else
-volatile uint32_t *_portRegister;
-//#endif
+};
+
+template<class Pin>
+void SoftPwmTask::stepPin(Task* task, const Pin& pin)
+{
+  SoftPwmTask* spt = (SoftPwmTask*)task;
+  if(spt->_counter == spt->upperLimit) {
+    // -- Reached the upper limit.
+    if(spt->_value != 0) {
+      // -- Set to HIGH.
+      pin.high();
+    }
+    spt->_counter = 0;
+  }
+  else {
+    if(spt->_counter >= spt->_value) {
+      // -- Reached the value level.
+      // -- Set to LOW.
+      pin.low();
+    }
+    spt->_counter++;
+  }
+}
+
+/**
+ * SoftPwmTask on a pin known at compile time, e.g. FastSoftPwmTask<LED_BUILTIN>. A step sets the pin by a single
+ * store, so the PWM can run at a higher frequency or leave more time for the other tasks.
+ */
+template<uint8_t PIN>
+class FastSoftPwmTask : public SoftPwmTask
+{
+  public:
+    FastSoftPwmTask() : SoftPwmTask(PIN, &(FastSoftPwmTask::step)) {}
+
+  private:
+    static void step(Task* task) { SoftPwmTask::stepPin(task, FastPin<PIN>()); }
 };
 
 #endif
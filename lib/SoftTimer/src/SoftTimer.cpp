@@ -118,7 +118,20 @@ void SoftTimerClass::testAndCall(Task* task) {
   if(task->periodMicros <= (now - task->lastCallTimeMicros))
   {
     task->nowMicros = now;
+    if(this->dispatchHook != NULL) {
+      this->dispatchHook(task);
+    }
     task->callback(task);
+    if(this->dispatchHook != NULL) {
+      this->dispatchHook(NULL);
+    }
+
+    // -- Account the run time of the callback.
+    unsigned long runMicros = micros() - now;
+    task->runMicros += runMicros;
+    if(runMicros > task->maxRunMicros) {
+      task->maxRunMicros = runMicros;
+    }
 #ifdef STRICT_TIMING
     task->lastCallTimeMicros = calc;
 #else
@@ -60,6 +60,12 @@ class SoftTimerClass
      * For internal use only. You do not need to call this function.
      */
     void run();
+
+    /**
+     * Optional function, called with the task before each callback and with NULL after it. E.g. for tracing or
+     * supervision of the tasks.
+     */
+    void (*dispatchHook)(Task* task) = NULL;
   private:
     void testAndCall(Task* task);
     Task* _tasks = NULL;
@@ -31,6 +31,8 @@ Task::Task(unsigned long periodMs, void (*callback)(Task* me)) {
   this->setPeriodMs(periodMs);
   this->callback = callback;
   this->lastCallTimeMicros = 0;
+  this->runMicros = 0;
+  this->maxRunMicros = 0;
   this->nextTask = NULL;
 }
 
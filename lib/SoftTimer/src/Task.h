@@ -67,6 +67,17 @@ class Task
      * Start time of the task.
      */
     volatile unsigned long nowMicros;
+
+    /**
+     * Time spent in the callback in microseconds since the task was constructed. Overflows after about 71 minutes of
+     * pure run time, so always use the difference of two readings.
+     */
+    unsigned long runMicros;
+
+    /**
+     * Longest single callback run in microseconds. Can be reset to 0 by the reader to get the maximum of a window.
+     */
+    unsigned long maxRunMicros;
     
   private:
     /**
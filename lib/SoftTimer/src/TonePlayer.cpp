@@ -27,17 +27,34 @@
 #include "TonePlayer.h"
 #include "SoftTimer.h"
 
-const float trot = 1.05946309435929; // -- The twelfth root of two
-const float A440 = 440.0; // -- A440 (pitch standard)
+// -- The frequencies are computed by the compiler, a note costs a lookup.
+static constexpr MelodyFrequencies FREQUENCIES =
+  MelodyCompiler::frequencies(MelodyCompiler::MakeIndices<MELODY_HIGHEST - MELODY_LOWEST + 1>::type());
 
-TonePlayer::TonePlayer(int pin, unsigned long baseLength)  : Task(0, &(TonePlayer::step)) {
-  _outPin = pin;
+TonePlayer::TonePlayer(int pin, unsigned long baseLength)  : Task(0, &(TonePlayer::step)), _output(pin, 440.0) {
   _baseLength = baseLength;
+  _notes = NULL;
+  _tones = NULL;
+  _count = 0;
+  _pos = 0;
+  _playing = false;
 }
 
-void TonePlayer::play(String tones) {
+void TonePlayer::play(const char* tones) {
+  this->_notes = NULL;
   this->_tones = tones;
+  this->_count = strlen(tones) / 2;
+  this->start();
+}
+
+void TonePlayer::play(const MelodyNote* notes, size_t count) {
+  this->_notes = notes;
+  this->_tones = NULL;
+  this->_count = count;
+  this->start();
+}
 
+void TonePlayer::start() {
   SoftTimer.remove(this);
   this->setPeriodMs(0);
   this->_playing = true;
@@ -52,53 +69,37 @@ void TonePlayer::step(Task* task) {
   // -- play a small silence after each tone
   if(tp->_playing) {
     tp->_playing = false;
-    noTone(tp->_outPin);
+    tp->_output.stop();
     tp->setPeriodMs(tp->_baseLength / 20);
 //Serial.println("[Tone silence]");
     return;
   }
 
   // -- finished
-  if(tp->_pos >= tp->_tones.length()) {
+  if(tp->_pos >= tp->_count) {
     SoftTimer.remove(tp);
-    noTone(tp->_outPin);
+    tp->_output.stop();
 //Serial.println("[Tone Finished]");
     return;
   }
 
+  const MelodyNote note = tp->_notes ? tp->_notes[tp->_pos] : MelodyCompiler::note(tp->_tones, tp->_pos);
+
   // -- calculate length
-  char cLength = tp->_tones[tp->_pos+1];
-  tp->setPeriodMs((unsigned long)(cLength-'0') * tp->_baseLength);
+  tp->setPeriodMs((unsigned long)note.length * tp->_baseLength);
 
-  // -- calculate tone
-  char cPitch = tp->_tones[tp->_pos];
-  if(cPitch == '_') {
+  if(note.halfTones == MELODY_REST) {
     // -- add silence
-    noTone(tp->_outPin);
+    tp->_output.stop();
   } else {
-    float val = A440;
-    int tune = (int)(cPitch-'j'); // -- 'j' character means A note
-    if(tune < -9) {
-      tune += 6; // -- Skip characters between character capital 'Z' and 'a'.
-    }
-    tune += tp->tune;
-    if(tune > 0) {
-      while(tune != 0) {
-        val *= trot;
-        --tune;
-      }
-    } else {
-      while(tune != 0) {
-        val /= trot;
-        ++tune;
-      }
-    }
+    // -- look the tone up, tuned
+    const int halfTones = constrain(note.halfTones + tp->tune, MELODY_LOWEST, MELODY_HIGHEST);
 
     // -- play tone
-    tone(tp->_outPin, val);
+    tp->_output.setFrequency(FREQUENCIES.hz[halfTones - MELODY_LOWEST]);
+    tp->_output.start();
   }
   
   tp->_playing = true;
-  tp->_pos += 2;
+  tp->_pos++;
 }
-
@@ -29,6 +29,8 @@
 
 #include "Arduino.h"
 #include "Task.h"
+#include "HardFrequencyTask.h"
+#include "Melody.h"
 
 class TonePlayer : Task
 {
@@ -38,6 +40,7 @@ class TonePlayer : Task
       * Initialize the player.
       *  pin - Speaker pin.
       *  baseLength - The minimal length of a tone will be played in milliseconds.
+      * The tones are generated by a HardFrequencyTask on the pin, see there which timer it takes.
       */
     TonePlayer(int pin, unsigned long baseLength);
 
@@ -56,8 +59,23 @@ class TonePlayer : Task
       *   Character '_' means silence.
       *
       *   "c2e2g4" - Means C-note for 2 time-span, D-note for 2 time-span, E-note for 4 time-span.
+      *
+      *   The string is not copied, it must be kept until the end of the melody (e.g. a string literal).
+      */
+    void play(const char* tones);
+
+    /**
+      * Play a melody compiled by compileMelody() (see Melody.h), without parsing anything while playing:
+      *   static constexpr auto welcome = compileMelody("e1f1h2h1m2h2");
+      *   tonePlayer.play(welcome);
+      */
+    template<size_t N>
+    void play(const Melody<N>& melody) { this->play(melody.notes, N); }
+
+    /**
+      * Play count notes. The notes are not copied.
       */
-    void play(String tones);
+    void play(const MelodyNote* notes, size_t count);
 
     /**
      * Tune the music by half tones. (Use negative values to tune down.)
@@ -65,11 +83,15 @@ class TonePlayer : Task
     int tune = 0;
 
   private:
-    int _outPin;
+    HardFrequencyTask _output;
     unsigned long _baseLength;
-    String _tones;
+    // -- Either the compiled notes or the text form is played.
+    const MelodyNote* _notes;
+    const char* _tones;
+    size_t _count;
     size_t _pos;
     bool _playing;
+    void start();
     static void step(Task* me);
 };
 
@@ -0,0 +1,8 @@
+import os
+
+Import("env")
+
+# noinit.ld includes the board's own linker script by name
+framework = env.PioPlatform().get_package_dir("framework-arduino-samd")
+variant = env.BoardConfig().get("build.variant")
+env.Append(LIBPATH=[os.path.join(framework, "variants", variant, "linker_scripts", "gcc")])
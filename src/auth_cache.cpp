@@ -0,0 +1,121 @@
+#include "auth_cache.h"
+#include "config.h"
+
+namespace AuthCache {
+    static_assert((AUTH_CACHE_SIZE & (AUTH_CACHE_SIZE - 1)) == 0, "AUTH_CACHE_SIZE must be a power of two");
+
+    static const uint16_t MASK      = AUTH_CACHE_SIZE - 1;
+    static const uint16_t NOT_FOUND = AUTH_CACHE_SIZE;
+    // no tag has id 0, the reader reports it when nothing was read
+    static const uint32_t EMPTY     = 0;
+
+    struct Entry {
+        uint32_t tag;
+        // millis() when the entry expires, 0 if never
+        uint32_t expiresAt;
+    };
+
+    static Entry entries[AUTH_CACHE_SIZE] = {};
+    static Stats stats_                   = {};
+
+    static uint16_t hash(uint32_t tag) {
+        // Fibonacci hashing, so sequential tag ids are spread over the whole table
+        return uint16_t((tag * 2654435761UL) >> 16) & MASK;
+    }
+
+    static bool expired(const Entry &entry) {
+        return entry.expiresAt && int32_t(entry.expiresAt - millis()) <= 0;
+    }
+
+    static uint16_t find(uint32_t tag) {
+        if (tag == EMPTY) return NOT_FOUND;
+
+        for (uint16_t slot = hash(tag); entries[slot].tag != EMPTY; slot = (slot + 1) & MASK) {
+            if (entries[slot].tag == tag) return slot;
+        }
+        return NOT_FOUND;
+    }
+
+    // linear probing without tombstones: the entries after the removed one are shifted back into the hole
+    // unless that would put them before their home slot
+    static void remove(uint16_t slot) {
+        uint16_t hole = slot;
+
+        for (uint16_t next = (hole + 1) & MASK; entries[next].tag != EMPTY; next = (next + 1) & MASK) {
+            const uint16_t home = hash(entries[next].tag);
+
+            if (((next - home) & MASK) >= ((next - hole) & MASK)) {
+                entries[hole] = entries[next];
+                hole = next;
+            }
+        }
+
+        entries[hole] = {EMPTY, 0};
+        --stats_.entries;
+    }
+
+    static void removeExpired() {
+        for (uint16_t slot = 0; slot < AUTH_CACHE_SIZE;) {
+            // a removal may shift the next entry into this slot, so it is checked again
+            if (entries[slot].tag != EMPTY && expired(entries[slot])) remove(slot);
+            else ++slot;
+        }
+    }
+}
+
+bool AuthCache::allow(uint32_t tag, uint32_t ttlSeconds) {
+    if (tag == EMPTY) return false;
+
+    // 0 is reserved for "never", so the odd neighbour of a deadline that happens to be 0 is used
+    const uint32_t expiresAt = ttlSeconds ? (millis() + min(ttlSeconds, AUTH_CACHE_TTL_MAX_S) * 1000) | 1 : 0;
+
+    const uint16_t found = find(tag);
+    if (found != NOT_FOUND) {
+        entries[found].expiresAt = expiresAt;
+        return true;
+    }
+
+    // probe chains grow quickly above 3/4 load
+    if (stats_.entries >= AUTH_CACHE_SIZE * 3 / 4) removeExpired();
+    if (stats_.entries >= AUTH_CACHE_SIZE * 3 / 4) {
+        ++stats_.rejected;
+        return false;
+    }
+
+    uint16_t slot = hash(tag);
+    while (entries[slot].tag != EMPTY) slot = (slot + 1) & MASK;
+
+    entries[slot] = {tag, expiresAt};
+    ++stats_.entries;
+
+    return true;
+}
+
+bool AuthCache::revoke(uint32_t tag) {
+    const uint16_t slot = find(tag);
+    if (slot == NOT_FOUND) return false;
+
+    remove(slot);
+    return true;
+}
+
+void AuthCache::clear() {
+    memset(entries, 0, sizeof(entries));
+    stats_.entries = 0;
+}
+
+bool AuthCache::allowed(uint32_t tag) {
+    const uint16_t slot = find(tag);
+
+    if (slot == NOT_FOUND || expired(entries[slot])) {
+        if (slot != NOT_FOUND) remove(slot);
+
+        ++stats_.misses;
+        return false;
+    }
+
+    ++stats_.hits;
+    return true;
+}
+
+const AuthCache::Stats &AuthCache::stats() { return stats_; }
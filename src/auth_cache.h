@@ -0,0 +1,33 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_AUTH_CACHE_H
+#define LETOVO_COMPUTERS_ARDUINO_AUTH_CACHE_H
+
+#include <Arduino.h>
+
+// number of slots of the tag table, a power of two; it is kept at most 3/4 full
+#define AUTH_CACHE_SIZE 256
+
+// Tags the server allowed to open the door, so a scan of a known tag opens it without waiting for the server.
+// An open addressing hash table in RAM, filled by the server with allow-list deltas; every entry may expire.
+namespace AuthCache {
+    struct Stats {
+        uint16_t entries;
+        // lookups of allowed / unknown or expired tags
+        uint16_t hits;
+        uint16_t misses;
+        // allow() calls rejected because the table was full
+        uint16_t rejected;
+    };
+
+    // ttlSeconds - 0 for an entry that never expires; capped to AUTH_CACHE_TTL_MAX_S
+    bool allow(uint32_t tag, uint32_t ttlSeconds);
+
+    bool revoke(uint32_t tag);
+
+    void clear();
+
+    bool allowed(uint32_t tag);
+
+    const Stats &stats();
+}
+
+#endif //LETOVO_COMPUTERS_ARDUINO_AUTH_CACHE_H
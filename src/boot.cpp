@@ -0,0 +1,39 @@
+#include "boot.h"
+
+#include "log.h"
+
+namespace Boot {
+    static uint32_t stamps[PHASES] = {};
+}
+
+const char *Boot::as_string(Phase phase) {
+    switch (phase) {
+        case SETUP:
+            return "setup";
+        case INPUTS:
+            return "inputs";
+        case SCHEDULED:
+            return "scheduled";
+        case WIFI:
+            return "wifi";
+        case BROKER:
+            return "broker";
+        case PUBLISHED:
+            return "published";
+        default:
+            return "unknown phase";
+    }
+}
+
+void Boot::mark(Phase phase) {
+    if (phase >= PHASES || stamps[phase]) return;
+
+    // 0 means not reached, a phase can not be reached in the very first microsecond anyway
+    stamps[phase] = max<uint32_t>(micros(), 1);
+
+    LOG_INFO("## Boot phase %s at %lu us", as_string(phase), (unsigned long) stamps[phase]);
+}
+
+uint32_t Boot::at(Phase phase) {
+    return phase < PHASES ? stamps[phase] : 0;
+}
@@ -0,0 +1,29 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_BOOT_H
+#define LETOVO_COMPUTERS_ARDUINO_BOOT_H
+
+#include <Arduino.h>
+
+// Boot timeline: micros() since the reset at the first time each phase was reached. setup() only brings up the
+// inputs and the scheduler, the network phases are reached by the background tasks, so a scan or a slot change is
+// captured from the SCHEDULED stamp on and queued until the PUBLISHED one.
+namespace Boot {
+    enum Phase : uint8_t {
+        SETUP     = 0,  // setup() entered
+        INPUTS    = 1,  // key matrix and RFID readers are capturing
+        SCHEDULED = 2,  // all tasks are registered, setup() returns
+        WIFI      = 3,  // first IP address
+        BROKER    = 4,  // first broker session
+        PUBLISHED = 5,  // first message delivered
+        PHASES    = 6,
+    };
+
+    const char *as_string(Phase phase);
+
+    // stamps the phase with micros(), only the first stamp counts
+    void mark(Phase phase);
+
+    // micros() of the phase, 0 if it was not reached yet
+    uint32_t at(Phase phase);
+}
+
+#endif //LETOVO_COMPUTERS_ARDUINO_BOOT_H
@@ -1,29 +1,173 @@
 #ifndef LETOVO_COMPUTERS_ARDUINO_CONFIG_H
 #define LETOVO_COMPUTERS_ARDUINO_CONFIG_H
 
-#include <set>
-#include <vector>
-
 #include <Arduino_JSON.h>
 
 #include "secrets.h"
 
-static const char     *brokerHost = MQTT_HOST;
-static const uint16_t brokerPort  = MQTT_PORT;
-static const char     *brokerUser = MQTT_USER;
-static const char     *brokerPass = MQTT_PASS;
-static const char     *clientID   = MQTT_CLIENT_ID;
+#ifndef ARDUINO_SNAPSHOT_TOPIC
+#define ARDUINO_SNAPSHOT_TOPIC ARDUINO_STREAM_TOPIC "/snapshot"
+#endif
+
+#ifndef SNAPSHOT_INTERVAL
+#define SNAPSHOT_INTERVAL 60000
+#endif
+
+#ifndef RFID_READERS
+#define RFID_READERS 1
+#endif
+
+#ifndef ARDUINO_TELEMETRY_TOPIC
+#define ARDUINO_TELEMETRY_TOPIC ARDUINO_STREAM_TOPIC "/telemetry"
+#endif
+
+#ifndef ARDUINO_TRACE_TOPIC
+#define ARDUINO_TRACE_TOPIC ARDUINO_STREAM_TOPIC "/trace"
+#endif
+
+#ifndef TELEMETRY_INTERVAL
+#define TELEMETRY_INTERVAL 60000
+#endif
+
+#ifndef DOOR_HOLD
+#define DOOR_HOLD 5000
+#endif
+
+// 1: an allocation after setup() that the pools cannot serve resets the device, see heap.h
+#ifndef HEAP_LOCKED
+#define HEAP_LOCKED 0
+#endif
+
+// network settings: the defaults come from secrets.h and the macros above, Settings::begin() points them into the
+// record saved in flash if there is one (see settings.h)
+extern const char *brokerHost;
+extern uint16_t   brokerPort;
+extern const char *brokerUser;
+extern const char *brokerPass;
+extern const char *clientID;
+
+extern const char *wifiSSID;
+extern const char *wifiPass;
+
+extern const char *arduinoStreamTopic;
+extern const char *arduinoWillTopic;
+extern const char *serverStreamTopic;
+extern const char *serverWillTopic;
+extern const char *arduinoSnapshotTopic;
+extern const char *arduinoTelemetryTopic;
+extern const char *arduinoTraceTopic;
+
+// period of the retained state snapshot in ms
+static const unsigned long SNAPSHOT_INTERVAL_MS = SNAPSHOT_INTERVAL;
 
-static const char *wifiSSID = WIFI_SSID;
-static const char *wifiPass = WIFI_PASS;
+// period of the telemetry report in ms
+static const unsigned long TELEMETRY_INTERVAL_MS = TELEMETRY_INTERVAL;
+// every n-th telemetry report contains all metrics, the others only the changed ones
+static const uint16_t      TELEMETRY_FULL_EVERY  = 10;
 
-static const char *arduinoStreamTopic = ARDUINO_STREAM_TOPIC;
-static const char *arduinoWillTopic = ARDUINO_WILL_TOPIC;
-static const char *serverStreamTopic = SERVER_STREAM_TOPIC;
-static const char *serverWillTopic = SERVER_WILL_TOPIC;
+// step period of the connection manager in ms
+static const unsigned long CONNECTION_STEP_MS        = 100;
+// delay before the first retry, doubled after each failed attempt up to the max, in ms
+static const unsigned long CONNECTION_BACKOFF_MIN_MS = 1000;
+static const unsigned long CONNECTION_BACKOFF_MAX_MS = 60000;
+// an attempt is considered failed if its state lasts longer than this, in ms
+static const unsigned long WIFI_ASSOCIATE_TIMEOUT_MS = 15000;
+static const unsigned long WIFI_DHCP_TIMEOUT_MS      = 10000;
+// a single wait of the client for a CONNACK, SUBACK or publish ack, in ms; a missed one is retried in a later step
+static const unsigned long MQTT_ACK_TIMEOUT_MS         = 1000;
+// the subscriptions after a connect must be done within this, else the connection is dropped and retried, in ms
+static const unsigned long BROKER_SUBSCRIBE_TIMEOUT_MS = 10000;
 
-static const JSONVar willPayload(  // NOLINT
-        R"({"message":"arduino with RFID reader disconnected","RFID":"","slots":"", status:3})");
+#if USE_PERSISTENT_SESSION
+// the broker only queues messages for offline clients on QoS 1/2 subscriptions
+static const uint8_t SUBSCRIBE_QOS         = 1;
+#else
+static const uint8_t SUBSCRIBE_QOS         = 0;
+#endif
+
+// step period of the outbound scheduler in ms, at most one message is published per step
+static const unsigned long OUTBOUND_STEP_MS           = 10;
+// max number of queued messages per class, the oldest one is dropped when a class is full; a telemetry report takes
+// up to three messages
+static const uint8_t       OUTBOUND_INTERACTIVE_QUEUE = 2;
+static const uint8_t       OUTBOUND_INVENTORY_QUEUE   = 6;
+static const uint8_t       OUTBOUND_TELEMETRY_QUEUE   = 3;
+// a message is dropped after this many failed attempts while the connection stayed up
+static const uint8_t       OUTBOUND_ATTEMPTS_MAX      = 5;
+
+// longest lifetime of a cached allow-list entry in s, keeps the millis() deadline comparison unambiguous
+static const uint32_t AUTH_CACHE_TTL_MAX_S = 20UL * 24 * 60 * 60;
+
+// step period of the latency tracing in ms
+static const unsigned long TRACE_STEP_MS    = 100;
+// a trace that did not reach all its stages in this time is closed with the ones it has
+static const uint32_t      TRACE_TIMEOUT_MS = 5000;
+
+// step period of the tag directory update in ms, every step erases a flash row or writes a page
+static const unsigned long TAG_DIRECTORY_STEP_MS = 5;
+
+// servo angle of the open and of the closed door
+static const uint8_t       DOOR_OPEN_ANGLE   = 0;
+static const uint8_t       DOOR_CLOSED_ANGLE = 90;
+// duration of a full move in ms and the number of steps it is made in, a step per servo frame
+static const unsigned long DOOR_RAMP_MS      = 300;
+static const uint8_t       DOOR_RAMP_STEPS   = 15;
+// an open door is closed again after this time in ms
+static const unsigned long DOOR_HOLD_MS      = DOOR_HOLD;
+// the servo still gets pulses this long after a move, then it is detached, in ms
+static const unsigned long DOOR_DETACH_MS    = 500;
+
+// step period of the log output in ms, every step writes up to LOG_DRAIN_BYTES
+static const unsigned long LOG_STEP_MS            = 20;
+// step period of the flight recorder in ms, every step prints and publishes a part of the previous boot's log
+static const unsigned long FLIGHT_RECORDER_STEP_MS = 100;
+// step period of the serial console in ms
+static const unsigned long CONSOLE_STEP_MS        = 50;
+// a reboot requested by the server waits this long in ms, so the acknowledgement gets out first
+static const unsigned long CONFIG_REBOOT_DELAY_MS = 2000;
+
+// the watchdog is fed at most this often in ms, the hardware resets the device 2 s after the latest feed
+static const unsigned long WATCHDOG_FEED_MS           = 250;
+// execution budget of a task callback in ms, unless the task has its own
+static const unsigned long WATCHDOG_BUDGET_MS         = 1000;
+// a critical task that has not finished a callback for this long in ms stops the feeding
+static const unsigned long WATCHDOG_DEADLINE_MS       = 2000;
+
+// The budgets of the tasks that wait for the network are the sum of their blocking waits plus WATCHDOG_SLACK_MS for
+// the work around them. The outbound and lifecycle steps publish one message: at QoS 2 endMessage() waits for the
+// PUBREC and then for the PUBCOMP, 2 * MQTT_ACK_TIMEOUT_MS; a republish waits for one ack timeout in all. The broker
+// step of the connection manager waits for WiFiNINA's TCP connect, the TLS handshake and the CONNACK; a subscribing
+// step waits for one SUBACK, and the one after the last SUBACK publishes the birth, 2 acks at QoS 2. Both are less
+// than the broker step. In ms:
+//   outbound, lifecycle: 2 * 1000 + 500 = 2500
+//   connection:          10000 + 5000 (TLS only) + 1000 + 500 = 16500
+// WiFiNINA waits this long for a TCP connect, a constant of the library, in ms
+static const unsigned long WIFI_TCP_CONNECT_WAIT_MS   = 10000;
+#if USE_SSL
+// a full BearSSL handshake on the 48 MHz SAMD21 including the round trips, TLS_BENCHMARK_ROUNDS measures it, in ms
+static const unsigned long TLS_HANDSHAKE_WAIT_MS      = 5000;
+#else
+static const unsigned long TLS_HANDSHAKE_WAIT_MS      = 0;
+#endif
+static const unsigned long WATCHDOG_SLACK_MS          = 500;
+static const unsigned long WATCHDOG_PUBLISH_BUDGET_MS = 2 * MQTT_ACK_TIMEOUT_MS + WATCHDOG_SLACK_MS;
+static const unsigned long WATCHDOG_CONNECT_BUDGET_MS =
+        WIFI_TCP_CONNECT_WAIT_MS + TLS_HANDSHAKE_WAIT_MS + MQTT_ACK_TIMEOUT_MS + WATCHDOG_SLACK_MS;
+
+// allocation pools used after setup(): block size in bytes and number of blocks of each, the small blocks take the
+// JSON nodes and keys, the medium ones the short strings, the large ones the stringified messages: cJSON doubles its
+// print buffer when it grows, so a message of OUTBOUND_PAYLOAD_MAX bytes takes a block of twice that
+static const size_t   HEAP_SMALL_BLOCK  = 48;
+static const uint16_t HEAP_SMALL_COUNT  = 48;
+static const size_t   HEAP_MEDIUM_BLOCK = 128;
+static const uint16_t HEAP_MEDIUM_COUNT = 12;
+static const size_t   HEAP_LARGE_BLOCK  = 704;
+static const uint16_t HEAP_LARGE_COUNT  = 4;
+
+// QoS of the will and of the birth that replaces it
+static const uint8_t       WILL_QOS          = 2;
+// an unacknowledged birth is sent again this often in ms while the connection is up
+static const unsigned long LIFECYCLE_STEP_MS = 1000;
 
 // num of rows
 static const uint8_t ROWS                  = 6;
@@ -40,10 +184,10 @@ static const char    *SLOT_IDS[ROWS][COLS] = {
 };
 static const uint8_t ROW_PINS[ROWS]        = {2, 3, 4, 5, 6, 7};
 static const uint8_t COL_PINS[COLS]        = {8, 9, 10, 11, 12};
-static const uint8_t RDM6300_RX_PIN        = 0;
+static const uint32_t RDM6300_BAUD_RATE    = 9600;
+// a tag is gone when it was not seen for this long, reading it again after that is a new scan
+static const uint32_t RFID_TAG_TIMEOUT_MS  = 300;
 static const uint8_t SERVO_PIN             = A0;
 static const uint8_t LED_PIN               = LED_BUILTIN;
 
-static char latestRFID[20] = "null";
-
 #endif //LETOVO_COMPUTERS_ARDUINO_CONFIG_H
@@ -0,0 +1,285 @@
+#include <Arduino.h>
+#include <WiFiNINA.h>
+#include <ArduinoMqttClient.h>
+
+#include "connection.h"
+#include "config.h"
+#include "boot.h"
+#include "flight_recorder.h"
+#include "log.h"
+
+namespace Connection {
+    static MqttClient    *mqttClient = nullptr;
+    static MqttTransport *transport  = nullptr;
+
+    static void (*onReady)() = nullptr;
+
+    static State state_ = State::LINK_DOWN;
+    static Stats stats_ = {};
+
+    // start of the current state and the time the current state gives up at
+    static unsigned long enteredAt = 0;
+    static unsigned long timeout   = 0;
+
+    // the next attempt in LINK_DOWN / BROKER_CONNECTING is not made before this time
+    static unsigned long retryAt   = 0;
+    // failed attempts in a row, reset on success
+    static uint8_t       attempts  = 0;
+
+    // server topics subscribed in the current session
+    static uint8_t       subscribed = 0;
+    static const uint8_t TOPICS     = 2;
+
+    static void enter(State next, unsigned long stateTimeout = 0) {
+        LOG_DEBUG("# connection: %s -> %s", as_string(state_), as_string(next));
+        FlightRecorder::record(FlightRecorder::CONNECTION, uint8_t(next));
+
+        state_    = next;
+        enteredAt = millis();
+        timeout   = stateTimeout;
+    }
+
+    static bool timedOut() {
+        return timeout && millis() - enteredAt >= timeout;
+    }
+
+    static bool retryDue() {
+        return long(millis() - retryAt) >= 0;
+    }
+
+    // exponential backoff with "equal jitter": the delay is picked from [d/2, d), so devices that lost
+    // the connection at the same moment (e.g. after a power cut) do not retry in lock-step
+    static void backoff() {
+        unsigned long delayMs = CONNECTION_BACKOFF_MIN_MS;
+        for (uint8_t i = 0; i < attempts && delayMs < CONNECTION_BACKOFF_MAX_MS; ++i) {
+            delayMs <<= 1;
+        }
+        delayMs = min(delayMs, CONNECTION_BACKOFF_MAX_MS);
+
+        if (attempts < UINT8_MAX) ++attempts;
+
+        retryAt = millis() + delayMs / 2 + random(long(delayMs / 2));
+    }
+
+    static void linkLost() {
+        LOG_WARN("## Lost connection to the Internet");
+
+        mqttClient->stop();
+        WiFi.disconnect();
+
+        attempts = 0;
+        backoff();
+        enter(State::LINK_DOWN);
+    }
+
+    static void linkFailed() {
+        LOG_WARN("## Wi-Fi connection failed. Wi-Fi status: %d", int(WiFi.status()));
+
+        ++stats_.wifiFailures;
+
+        WiFi.disconnect();
+
+        backoff();
+        enter(State::LINK_DOWN);
+    }
+
+    // IPAddress keeps the first byte in the lowest one
+    static void logAddress(__attribute__((unused)) uint32_t address) {
+        LOG_INFO("## Connected to the Internet. IP address: %u.%u.%u.%u", unsigned(address & 0xff),
+                 unsigned(address >> 8 & 0xff), unsigned(address >> 16 & 0xff), unsigned(address >> 24));
+    }
+
+    static void brokerLost(const char *reason) {
+        LOG_WARN("## %s", reason);
+
+        mqttClient->stop();
+
+        // a dropped session is usually a short hiccup, retry soon but still with jitter
+        attempts = 0;
+        backoff();
+        enter(State::BROKER_CONNECTING);
+    }
+
+    // the next server topic, or the ready callback once all of them are subscribed
+    static void subscribeNext() {
+        if (subscribed == TOPICS) {
+            enter(State::SUBSCRIBED);
+            if (onReady) onReady();
+            return;
+        }
+
+        const char *topic = subscribed ? serverWillTopic : serverStreamTopic;
+
+        // bounded by the ack timeout of the client, the next step tries again
+        if (mqttClient->subscribe(topic, SUBSCRIBE_QOS)) {
+            LOG_INFO("## Subscribed to %s", topic);
+            ++subscribed;
+            return;
+        }
+
+        LOG_WARN("## Failed to subscribe to %s", topic);
+
+        if (timedOut()) {
+            ++stats_.brokerFailures;
+            brokerLost("Subscribing timed out");
+        }
+    }
+
+    static void connectToBroker() {
+        // the TCP/TLS connect, then the CONNACK bounded by the ack timeout of the client, no retries in here
+        if (!mqttClient->connect(brokerHost, brokerPort)) {
+            LOG_WARN("## MQTT connection failed. Error no: %d", mqttClient->connectError());
+
+            ++stats_.brokerFailures;
+            backoff();
+            return;
+        }
+
+        LOG_INFO("## Connected to the broker. Client ID: %s", clientID);
+
+        ++stats_.brokerConnects;
+        attempts = 0;
+        Boot::mark(Boot::BROKER);
+
+        subscribed = 0;
+#if USE_PERSISTENT_SESSION
+        // the broker kept our subscriptions together with the session
+        if (transport->sessionPresent()) {
+            LOG_INFO("## Session present, skipping subscriptions");
+            subscribed = TOPICS;
+        }
+#endif
+
+        // the subscriptions and the ready callback follow in the next steps
+        enter(State::SUBSCRIBING, BROKER_SUBSCRIBE_TIMEOUT_MS);
+    }
+}
+
+const char *Connection::as_string(State state) {
+    switch (state) {
+        case State::LINK_DOWN:
+            return "link down";
+        case State::ASSOCIATING:
+            return "associating";
+        case State::DHCP:
+            return "waiting for DHCP";
+        case State::BROKER_CONNECTING:
+            return "connecting to the broker";
+        case State::SUBSCRIBING:
+            return "subscribing";
+        case State::SUBSCRIBED:
+            return "subscribed";
+        default:
+            return "unknown state";
+    }
+}
+
+void Connection::begin(MqttClient &client, MqttTransport &clientTransport, void (*readyCallback)()) {
+    mqttClient = &client;
+    transport  = &clientTransport;
+    onReady    = readyCallback;
+
+    // every wait of the client for an ack: CONNACK, SUBACK, PUBACK, PUBREC, PUBCOMP
+    mqttClient->setConnectionTimeout(MQTT_ACK_TIMEOUT_MS);
+#if USE_PERSISTENT_SESSION
+    // keep subscriptions and queued QoS 1/2 messages on the broker across reconnects, clientID must be stable
+    mqttClient->setCleanSession(false);
+#endif
+
+    // WiFi.begin() would otherwise block until the access point answers
+    WiFi.setTimeout(0);
+
+    // devices sharing a power line must not share the jitter sequence
+    unsigned long seed = micros();
+    for (const char *c = clientID; *c; ++c) {
+        seed = seed * 31 + *c;
+    }
+    randomSeed(seed);
+
+    state_  = State::LINK_DOWN;
+    retryAt = millis();
+}
+
+void Connection::step(__attribute__((unused)) Task *me) {
+    switch (state_) {
+        case State::LINK_DOWN:
+            if (!retryDue()) return;
+
+            LOG_INFO("# connecting to %s", wifiSSID);
+
+            WiFi.begin(wifiSSID, wifiPass);
+            enter(State::ASSOCIATING, WIFI_ASSOCIATE_TIMEOUT_MS);
+            return;
+
+        case State::ASSOCIATING:
+            switch (WiFi.status()) {
+                case WL_CONNECTED:
+                    enter(State::DHCP, WIFI_DHCP_TIMEOUT_MS);
+                    return;
+                case WL_CONNECT_FAILED:
+                    linkFailed();
+                    return;
+                default:
+                    if (timedOut()) linkFailed();
+                    return;
+            }
+
+        case State::DHCP:
+            if (WiFi.status() != WL_CONNECTED) {
+                linkLost();
+                return;
+            }
+            if (uint32_t(WiFi.localIP()) == 0) {
+                if (timedOut()) linkFailed();
+                return;
+            }
+
+            logAddress(WiFi.localIP());
+
+            ++stats_.wifiConnects;
+            attempts = 0;
+            Boot::mark(Boot::WIFI);
+            retryAt  = millis();
+            enter(State::BROKER_CONNECTING);
+            return;
+
+        case State::BROKER_CONNECTING:
+            if (WiFi.status() != WL_CONNECTED) {
+                linkLost();
+                return;
+            }
+            if (!retryDue()) return;
+
+            connectToBroker();
+            return;
+
+        case State::SUBSCRIBING:
+            if (WiFi.status() != WL_CONNECTED) {
+                linkLost();
+                return;
+            }
+            if (!mqttClient->connected()) {
+                brokerLost("Lost connection to the broker");
+                return;
+            }
+
+            subscribeNext();
+            return;
+
+        case State::SUBSCRIBED:
+            if (WiFi.status() != WL_CONNECTED) {
+                linkLost();
+                return;
+            }
+            if (mqttClient->connected()) return;
+
+            brokerLost("Lost connection to the broker");
+            return;
+    }
+}
+
+Connection::State Connection::state() { return state_; }
+
+bool Connection::ready() { return state_ == State::SUBSCRIBED; }
+
+const Connection::Stats &Connection::stats() { return stats_; }
@@ -0,0 +1,46 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_CONNECTION_H
+#define LETOVO_COMPUTERS_ARDUINO_CONNECTION_H
+
+#include <ArduinoMqttClient.h>
+#include <SoftTimer.h>
+
+#include "transport.h"
+
+// Non-blocking Wi-Fi & MQTT connection manager. Every call to step() does at most one action and returns, so the
+// other tasks keep running while the device (re)connects: an MQTT step sends one packet and waits for its ack for
+// MQTT_ACK_TIMEOUT_MS at most. Only the TCP/TLS connect under the CONNECT blocks longer, WiFiNINA and BearSSL have
+// no way to split it.
+namespace Connection {
+    enum class State : uint8_t {
+        LINK_DOWN         = 0,  // waiting for the backoff to pass before the next Wi-Fi attempt
+        ASSOCIATING       = 1,  // WiFi.begin() was issued, waiting for the access point
+        DHCP              = 2,  // associated, waiting for an IP address
+        BROKER_CONNECTING = 3,  // waiting for the backoff to pass before the next broker attempt
+        SUBSCRIBING       = 5,  // connected, one server topic subscribed per step (added last, recorded numbers stay)
+        SUBSCRIBED        = 4,  // connected to the broker and subscribed to the server topics
+    };
+
+    struct Stats {
+        // successful Wi-Fi associations / broker sessions since boot
+        uint16_t wifiConnects;
+        uint16_t brokerConnects;
+        // failed attempts since boot
+        uint16_t wifiFailures;
+        uint16_t brokerFailures;
+    };
+
+    const char *as_string(State state);
+
+    // onReady is called every time the SUBSCRIBED state is entered
+    void begin(MqttClient &client, MqttTransport &transport, void (*onReady)());
+
+    void step(Task *me);
+
+    State state();
+
+    bool ready();
+
+    const Stats &stats();
+}
+
+#endif //LETOVO_COMPUTERS_ARDUINO_CONNECTION_H
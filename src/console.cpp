@@ -0,0 +1,87 @@
+#include "console.h"
+
+#include <Arduino.h>
+
+#include "settings.h"
+
+namespace Console {
+    static char    line[CONSOLE_LINE_MAX + 1];
+    static uint8_t length = 0;
+    // the line did not fit, the rest of it is skipped
+    static bool    overflow = false;
+
+    static void help() {
+        Serial.println("# commands: help | show | set <KEY> <value> | defaults | save | reboot");
+        Serial.print("# keys:");
+        for (uint8_t i = 0; i < Settings::count(); ++i) {
+            Serial.print(' ');
+            Serial.print(Settings::key(i));
+        }
+        Serial.println();
+    }
+
+    static void run(char *command) {
+        // the value is the rest of the line, so it may contain spaces
+        char *key   = strchr(command, ' ');
+        char *value = nullptr;
+        if (key) {
+            *key++ = '\0';
+            value = strchr(key, ' ');
+            if (value) *value++ = '\0';
+        }
+
+        if (!strcmp(command, "show")) {
+            Settings::print(Serial);
+        } else if (!strcmp(command, "set") && key) {
+            const Settings::Result result = Settings::set(key, value ? value : "");
+
+            Serial.print("# ");
+            Serial.println(Settings::as_string(result));
+        } else if (!strcmp(command, "defaults")) {
+            Settings::defaults();
+            Serial.println("# defaults staged, save to keep them");
+        } else if (!strcmp(command, "save")) {
+            const Settings::Result result = Settings::save();
+
+            Serial.print("# ");
+            Serial.print(Settings::as_string(result));
+            Serial.println(result == Settings::Result::OK ? ", reboot to apply" : "");
+        } else if (!strcmp(command, "reboot")) {
+            Serial.println("# rebooting");
+            Serial.flush();
+            NVIC_SystemReset();
+        } else {
+            help();
+        }
+    }
+}
+
+void Console::step(__attribute__((unused)) Task *me) {
+    // at most one line per step, the next one waits in the USB buffer
+    for (int available = Serial.available(); available > 0; --available) {
+        const char c = char(Serial.read());
+
+        if (c == '\r') continue;
+
+        if (c != '\n') {
+            if (length < CONSOLE_LINE_MAX) {
+                line[length++] = c;
+            } else {
+                overflow = true;
+            }
+            continue;
+        }
+
+        line[length] = '\0';
+        const bool skipped = overflow;
+        length   = 0;
+        overflow = false;
+
+        if (skipped) {
+            Serial.println("# line too long");
+        } else if (line[0]) {
+            run(line);
+        }
+        return;
+    }
+}
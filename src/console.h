@@ -0,0 +1,16 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_CONSOLE_H
+#define LETOVO_COMPUTERS_ARDUINO_CONSOLE_H
+
+#include <SoftTimer.h>
+
+// max length of a console line
+#define CONSOLE_LINE_MAX 160
+
+// Line-oriented console on the USB serial port for the settings of settings.h. Every step takes only the bytes that
+// have already arrived and runs a command once its line is complete, so a slow terminal never holds the scheduler.
+//   help | show | set <KEY> <value> | defaults | save | reboot
+namespace Console {
+    void step(Task *me);
+}
+
+#endif //LETOVO_COMPUTERS_ARDUINO_CONSOLE_H
@@ -0,0 +1,60 @@
+#include "dispatch.h"
+#include "config.h"
+#include "log.h"
+
+namespace Dispatch {
+    static const char *const FIELD_NAMES[] = {"message", "RFID", "slots"};
+
+    static Counters counters_[COMMANDS_MAX] = {};
+    static uint16_t unknown_                = 0;
+
+    static Topic topicOf(const char *topic) {
+        if (!strcmp(topic, serverStreamTopic)) return SERVER_STREAM;
+        if (!strcmp(topic, serverWillTopic)) return SERVER_WILL;
+        return NO_TOPIC;
+    }
+
+    static bool hasFields(const JSONVar &message, uint8_t fields) {
+        for (uint8_t i = 0; i < sizeof(FIELD_NAMES) / sizeof(FIELD_NAMES[0]); ++i) {
+            if ((fields & (1 << i)) && JSON.typeof(message[FIELD_NAMES[i]]) != "string") return false;
+        }
+        return true;
+    }
+
+    static bool reject(__attribute__((unused)) const char *reason, __attribute__((unused)) const JSONVar &message) {
+        LOG_WARN("[%s]: %s", reason, JSON.stringify(message).c_str());
+
+        return false;
+    }
+}
+
+bool Dispatch::dispatch(const Command *table, uint8_t size, const char *topic, const JSONVar &message) {
+    if (JSON.typeof(message["status"]) != "number") {
+        ++unknown_;
+        return reject("malformed message", message);
+    }
+
+    const int status = message["status"];
+    if (status < 0 || status >= size || !table[status].handler) {
+        ++unknown_;
+        return reject("unknown status", message);
+    }
+
+    const Command &command = table[status];
+    if (!(command.topics & topicOf(topic)) || !hasFields(message, command.fields)) {
+        ++counters_[status].rejected;
+        return reject("rejected command", message);
+    }
+
+    ++counters_[status].handled;
+    command.handler(message);
+
+    return true;
+}
+
+const Dispatch::Counters &Dispatch::counters(uint8_t status) {
+    static const Counters none = {};
+    return status < COMMANDS_MAX ? counters_[status] : none;
+}
+
+uint16_t Dispatch::unknown() { return unknown_; }
@@ -0,0 +1,56 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_DISPATCH_H
+#define LETOVO_COMPUTERS_ARDUINO_DISPATCH_H
+
+#include <Arduino_JSON.h>
+
+// Dispatch of incoming server messages through a constant table indexed by the status code.
+// Adding a command means adding its handler and one table entry in main.cpp.
+namespace Dispatch {
+    // topics a command is accepted on
+    enum Topic : uint8_t {
+        NO_TOPIC      = 0,
+        SERVER_STREAM = 1 << 0,
+        SERVER_WILL   = 1 << 1,
+        ANY_TOPIC     = SERVER_STREAM | SERVER_WILL,
+    };
+
+    // string fields a handler reads, checked before the handler is called
+    enum Field : uint8_t {
+        NO_FIELDS = 0,
+        MESSAGE   = 1 << 0,
+        RFID      = 1 << 1,
+        SLOTS     = 1 << 2,
+    };
+
+    struct Command {
+        uint8_t status;
+        uint8_t topics;
+        uint8_t fields;
+        void    (*handler)(const JSONVar &message);
+    };
+
+    struct Counters {
+        uint16_t handled;
+        // wrong topic or missing fields
+        uint16_t rejected;
+    };
+
+    // status codes are below this, so counters can be kept for every one of them
+    static const uint8_t COMMANDS_MAX = 16;
+
+    // every entry with a handler must sit at the index equal to its status code
+    template<size_t N>
+    constexpr bool isIndexed(const Command (&table)[N], size_t i = 0) {
+        return i == N || ((!table[i].handler || table[i].status == i) && isIndexed(table, i + 1));
+    }
+
+    // looks the command up by the status code, checks the topic and the fields, then calls the handler
+    bool dispatch(const Command *table, uint8_t size, const char *topic, const JSONVar &message);
+
+    const Counters &counters(uint8_t status);
+
+    // messages without a valid status or with a status that has no handler
+    uint16_t unknown();
+}
+
+#endif //LETOVO_COMPUTERS_ARDUINO_DISPATCH_H
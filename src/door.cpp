@@ -0,0 +1,139 @@
+#include "door.h"
+
+#include <DelayRun.h>
+#include <Servo.h>
+
+#include "config.h"
+
+namespace Door {
+    static Servo servo;
+    static uint8_t servoPin = 0;
+
+    static State state_ = CLOSED;
+    static void (*onChange)(State state) = nullptr;
+
+    // current angle and the change of a ramp step, in degrees
+    static float position  = DOOR_CLOSED_ANGLE;
+    static float stepLevel = float(abs(int(DOOR_OPEN_ANGLE) - int(DOOR_CLOSED_ANGLE))) / DOOR_RAMP_STEPS;
+    // millis() when the latest move has reached its end
+    static unsigned long settledAt = 0;
+
+    static void step(Task *me);
+
+    static boolean autoClose(Task *me);
+
+    static Task     ramp(DOOR_RAMP_MS / DOOR_RAMP_STEPS, step);
+    static DelayRun closeTimer(DOOR_HOLD_MS, autoClose);
+
+    static float target() {
+        return state_ == OPENING || state_ == OPEN ? DOOR_OPEN_ANGLE : DOOR_CLOSED_ANGLE;
+    }
+
+    static void write() {
+        servo.write(int(position + 0.5f));
+    }
+
+    static void move(State moving) {
+        state_ = moving;
+
+        if (!servo.attached()) {
+            // attach() starts with the latest written pulse width, so the servo does not jump
+            write();
+            servo.attach(servoPin);
+        }
+
+        SoftTimer.add(&ramp);
+    }
+
+    static void step(Task *me) {
+        const float to = target();
+
+        if (position != to) {
+            const float direction = to > position ? 1 : -1;
+
+            position += direction * stepLevel;
+            if ((direction > 0 && position > to) || (direction < 0 && position < to)) position = to;
+            write();
+
+            if (position == to) {
+                settledAt = millis();
+                state_    = state_ == OPENING ? OPEN : CLOSED;
+
+                if (state_ == OPEN) closeTimer.startDelayed();
+                if (onChange) onChange(state_);
+            }
+            return;
+        }
+
+        // the servo got enough pulses to reach the position, the lock holds it from now on
+        if (millis() - settledAt < DOOR_DETACH_MS) return;
+
+        servo.detach();
+        SoftTimer.remove(me);
+    }
+
+    static boolean autoClose(__attribute__((unused)) Task *me) {
+        close();
+        return false;
+    }
+}
+
+const char *Door::as_string(State state) {
+    switch (state) {
+        case CLOSED:
+            return "closed";
+        case OPENING:
+            return "opening";
+        case OPEN:
+            return "open";
+        case CLOSING:
+            return "closing";
+        default:
+            return "unknown";
+    }
+}
+
+void Door::begin(uint8_t pin, void (*changeCallback)(State state)) {
+    servoPin = pin;
+    onChange = changeCallback;
+
+    // the position is unknown after a reset, so the servo is driven to the closed one before it is detached
+    position  = DOOR_CLOSED_ANGLE;
+    state_    = CLOSED;
+    settledAt = millis();
+
+    move(CLOSED);
+}
+
+void Door::open() {
+    switch (state_) {
+        case CLOSED:
+        case CLOSING:
+            move(OPENING);
+            return;
+        case OPEN:
+            closeTimer.startDelayed();
+            return;
+        case OPENING:
+            return;
+    }
+}
+
+void Door::close() {
+    switch (state_) {
+        case OPEN:
+            SoftTimer.remove(&closeTimer);
+            move(CLOSING);
+            return;
+        case OPENING:
+            move(CLOSING);
+            return;
+        case CLOSED:
+        case CLOSING:
+            return;
+    }
+}
+
+Door::State Door::state() { return state_; }
+
+Task &Door::task() { return ramp; }
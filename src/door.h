@@ -0,0 +1,34 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_DOOR_H
+#define LETOVO_COMPUTERS_ARDUINO_DOOR_H
+
+#include <Arduino.h>
+#include <SoftTimer.h>
+
+// Door lock servo. A move ramps the position over DOOR_RAMP_MS in the steps of a Dimmer, an open door is closed again
+// by a one-shot timer after DOOR_HOLD_MS, and the servo is detached once it has settled, so the pulse generation
+// (a timer interrupt per pulse) only runs while the door moves.
+namespace Door {
+    enum State : uint8_t {
+        CLOSED  = 0,
+        OPENING = 1,
+        OPEN    = 2,
+        CLOSING = 3,
+    };
+
+    const char *as_string(State state);
+
+    // moves the servo to the closed position; onChange is called when the door has become OPEN or CLOSED
+    void begin(uint8_t pin, void (*onChange)(State state));
+
+    // opens the door, or keeps an open door open for another DOOR_HOLD_MS
+    void open();
+
+    void close();
+
+    State state();
+
+    // the ramp task, only registered in the SoftTimer while the servo is attached
+    Task &task();
+}
+
+#endif //LETOVO_COMPUTERS_ARDUINO_DOOR_H
@@ -0,0 +1,47 @@
+#include "flash.h"
+
+namespace Flash {
+    static const uint16_t STATUS_ERRORS = NVMCTRL_STATUS_PROGE | NVMCTRL_STATUS_LOCKE | NVMCTRL_STATUS_NVME;
+
+    static void waitReady() {
+        while (!NVMCTRL->INTFLAG.bit.READY);
+    }
+
+    static bool command(uint16_t cmd) {
+        // clear the errors of a previous command first
+        NVMCTRL->STATUS.reg = STATUS_ERRORS;
+
+        NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | cmd;
+        waitReady();
+
+        return !(NVMCTRL->STATUS.reg & STATUS_ERRORS);
+    }
+}
+
+bool Flash::eraseRow(const volatile void *address) {
+    waitReady();
+
+    // the address register takes 16-bit words
+    NVMCTRL->ADDR.reg = reinterpret_cast<uintptr_t>(address) / 2;
+    return command(NVMCTRL_CTRLA_CMD_ER);
+}
+
+bool Flash::writePage(const volatile void *address, const void *data) {
+    waitReady();
+
+    // a page is only written by the explicit WP command, not by the last write to the page buffer
+    NVMCTRL->CTRLB.bit.MANW = 1;
+    if (!command(NVMCTRL_CTRLA_CMD_PBC)) return false;
+
+    // the page buffer is filled by 32-bit writes to the flash address space
+    auto       *destination = reinterpret_cast<volatile uint32_t *>(reinterpret_cast<uintptr_t>(address));
+    auto const *source      = static_cast<const uint8_t *>(data);
+
+    for (uint32_t i = 0; i < PAGE_BYTES / 4; ++i) {
+        uint32_t word;
+        memcpy(&word, source + 4 * i, sizeof(word));
+        destination[i] = word;
+    }
+
+    return command(NVMCTRL_CTRLA_CMD_WP);
+}
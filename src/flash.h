@@ -0,0 +1,23 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_FLASH_H
+#define LETOVO_COMPUTERS_ARDUINO_FLASH_H
+
+#include <Arduino.h>
+
+// Self-programming of the internal flash through the NVM controller. Regions written at run time are reserved as
+// const arrays aligned to a row, so the linker keeps code out of them; they are erased by every firmware upload.
+// The CPU stalls on flash reads while a row is erased (a few ms) or a page is written, interrupts included, so
+// bigger updates should be spread over several task steps.
+namespace Flash {
+    // page size of the SAMD21G18 (NVMCTRL->PARAM.PSZ), the unit of a write
+    static const uint32_t PAGE_BYTES = 64;
+    // the unit of an erase
+    static const uint32_t ROW_BYTES  = 4 * PAGE_BYTES;
+
+    // erases the row containing address to 0xff, returns false if the NVM controller reported an error
+    bool eraseRow(const volatile void *address);
+
+    // writes PAGE_BYTES of data to the page-aligned address of an erased row
+    bool writePage(const volatile void *address, const void *data);
+}
+
+#endif //LETOVO_COMPUTERS_ARDUINO_FLASH_H
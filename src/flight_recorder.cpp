@@ -0,0 +1,263 @@
+#include "flight_recorder.h"
+
+#include <Arduino_JSON.h>
+
+#include "config.h"
+#include "connection.h"
+#include "log.h"
+#include "outbound.h"
+#include "persistent.h"
+
+namespace FlightRecorder {
+    static const uint32_t MAGIC    = 0x52434c46;  // "FLCR"
+    static const uint8_t  LOGS     = 2;
+    static const uint8_t  NO_TASK  = UINT8_MAX;
+    static const uint8_t  NO_LOG   = LOGS;
+    // events per message of the export, keeps the payload within OUTBOUND_PAYLOAD_MAX
+    static const uint8_t  EXPORT_CHUNK = 6;
+
+    struct Record {
+        // millis() of the event
+        uint32_t at;
+        uint8_t  event;
+        uint8_t  a;
+        uint16_t b;
+    };
+
+    struct Journal {
+        uint16_t next;
+        uint16_t count;
+        // task in its callback, NO_TASK between the callbacks, and millis() when the callback started
+        uint8_t  running;
+        uint32_t runningSince;
+        uint32_t faultPc;
+        Record   records[FLIGHT_RECORDER_EVENTS];
+    };
+
+    struct State {
+        uint32_t magic;
+        // log of the current boot
+        uint8_t  active;
+        uint16_t resets;
+        Journal  logs[LOGS];
+    };
+
+    NOINIT static State state;
+
+    static const Telemetry::TaskInfo *tasks     = nullptr;
+    static uint8_t                   tasksCount = 0;
+
+    // the log of the previous boot, NO_LOG after a power-on
+    static uint8_t previous = NO_LOG;
+    static uint8_t rcause   = 0;
+
+    // progress of the serial dump and of the export of the previous log, the summary is index 0
+    static uint16_t dumped   = 0;
+    static uint16_t exported = 0;
+
+    static bool valid() {
+        if (state.magic != MAGIC || state.active >= LOGS) return false;
+
+        for (const Journal &log: state.logs) {
+            if (log.next >= FLIGHT_RECORDER_EVENTS || log.count > FLIGHT_RECORDER_EVENTS) return false;
+        }
+        return true;
+    }
+
+    static void clear(Journal &log) {
+        log.next         = 0;
+        log.count        = 0;
+        log.running      = NO_TASK;
+        log.runningSince = 0;
+        log.faultPc      = 0;
+    }
+
+    static const Record &oldest(const Journal &log, uint16_t index) {
+        const uint16_t first = (log.next + FLIGHT_RECORDER_EVENTS - log.count) % FLIGHT_RECORDER_EVENTS;
+        return log.records[(first + index) % FLIGHT_RECORDER_EVENTS];
+    }
+
+    static const char *taskName(uint8_t index) {
+        return index < tasksCount ? tasks[index].name : "-";
+    }
+
+    static void onDispatch(Task *task) {
+        Journal &log = state.logs[state.active];
+
+        if (task) {
+            log.running      = taskIndex(task);
+            log.runningSince = millis();
+            return;
+        }
+
+        const uint32_t elapsed = millis() - log.runningSince;
+        if (elapsed > FLIGHT_RECORDER_SLOW_MS) {
+            record(SLOW_TASK, log.running, uint16_t(min<uint32_t>(elapsed, UINT16_MAX)));
+        }
+        log.running = NO_TASK;
+    }
+
+    static void dumpNext() {
+        const Journal &log = state.logs[previous];
+
+        if (dumped == 0) {
+            LOG_WARN("## Reset by %s in task %s, %u events before it", resetCause(rcause), taskName(log.running),
+                     unsigned(log.count));
+        } else {
+            const Record &record = oldest(log, dumped - 1);
+            LOG_INFO("# %lu ms: %s %u %u", (unsigned long) record.at, as_string(Event(record.event)),
+                     unsigned(record.a), unsigned(record.b));
+        }
+        ++dumped;
+    }
+
+    static bool exportNext() {
+        const Journal &log = state.logs[previous];
+
+        JSONVar message;
+        if (exported == 0) {
+            message["reset"]["cause"]  = resetCause(rcause);
+            message["reset"]["rcause"] = rcause;
+            message["reset"]["resets"] = state.resets;
+            message["reset"]["task"]   = taskName(log.running);
+            message["reset"]["events"] = log.count;
+            if (log.faultPc) message["reset"]["pc"] = double(log.faultPc);
+        } else {
+            const uint16_t from = (exported - 1) * EXPORT_CHUNK;
+            message["reset"]["from"] = from;
+
+            for (uint16_t i = 0; i < EXPORT_CHUNK && from + i < log.count; ++i) {
+                const Record &record = oldest(log, from + i);
+
+                message["reset"]["log"][i][0] = double(record.at);
+                message["reset"]["log"][i][1] = as_string(Event(record.event));
+                message["reset"]["log"][i][2] = record.a;
+                message["reset"]["log"][i][3] = record.b;
+            }
+        }
+
+        return Outbound::enqueue(Outbound::TELEMETRY, arduinoTelemetryTopic, JSON.stringify(message).c_str(), false);
+    }
+}
+
+// stacked by the exception entry: r0-r3, r12, lr, pc, xPSR
+extern "C" __attribute__((used)) void flightRecorderFault(const uint32_t *frame) {
+    FlightRecorder::fault(FlightRecorder::FAULT, frame[6], uint16_t(frame[6]));
+
+    NVIC_SystemReset();
+}
+
+// replaces the endless loop of the core; the sketch never uses the process stack, so the frame is on the main one
+extern "C" __attribute__((naked)) void HardFault_Handler() {
+    asm volatile(
+            "mrs r0, msp\n"
+            "b flightRecorderFault\n"
+            );
+}
+
+const char *FlightRecorder::as_string(Event event) {
+    switch (event) {
+        case BOOT:
+            return "boot";
+        case SLOW_TASK:
+            return "slow task";
+        case CONNECTION:
+            return "connection";
+        case PUBLISH:
+            return "publish";
+        case DROP:
+            return "drop";
+        case SCAN:
+            return "scan";
+        case FAULT:
+            return "fault";
+        case WATCHDOG:
+            return "watchdog";
+        case HEAP:
+            return "heap";
+        default:
+            return "unknown";
+    }
+}
+
+const char *FlightRecorder::resetCause(uint8_t cause) {
+    if (cause & PM_RCAUSE_WDT) return "watchdog";
+    if (cause & PM_RCAUSE_SYST) return "system reset request";
+    if (cause & PM_RCAUSE_EXT) return "reset pin";
+    if (cause & PM_RCAUSE_BOD33) return "brown-out 3.3 V";
+    if (cause & PM_RCAUSE_BOD12) return "brown-out 1.2 V";
+    if (cause & PM_RCAUSE_POR) return "power-on";
+    return "unknown";
+}
+
+void FlightRecorder::begin(const Telemetry::TaskInfo *taskInfos, uint8_t count) {
+    tasks      = taskInfos;
+    tasksCount = count;
+    rcause     = PM->RCAUSE.reg;
+
+    // RAM is only kept over a warm reset
+    const bool warm = !(rcause & (PM_RCAUSE_POR | PM_RCAUSE_BOD12 | PM_RCAUSE_BOD33));
+
+    if (warm && valid()) {
+        previous     = state.active;
+        state.active = previous == 0 ? 1 : 0;
+        if (state.resets < UINT16_MAX) ++state.resets;
+    } else {
+        state.magic  = MAGIC;
+        state.active = 0;
+        state.resets = 0;
+        previous     = NO_LOG;
+        for (Journal &log: state.logs) clear(log);
+    }
+
+    clear(state.logs[state.active]);
+    record(BOOT, rcause, state.resets);
+
+    SoftTimer.dispatchHook = onDispatch;
+}
+
+void FlightRecorder::record(Event event, uint8_t a, uint16_t b) {
+    Journal &log = state.logs[state.active];
+
+    // the watchdog records from the SysTick interrupt, a trip in here must neither take nor tear the same slot
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    log.records[log.next] = {uint32_t(millis()), event, a, b};
+    log.next = (log.next + 1) % FLIGHT_RECORDER_EVENTS;
+    if (log.count < FLIGHT_RECORDER_EVENTS) ++log.count;
+
+    __set_PRIMASK(primask);
+}
+
+void FlightRecorder::fault(Event event, uint32_t pc, uint16_t b) {
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    state.logs[state.active].faultPc = pc;
+    record(event, 0, b);
+
+    __set_PRIMASK(primask);
+}
+
+uint16_t FlightRecorder::resets() { return state.resets; }
+
+uint8_t FlightRecorder::taskIndex(const Task *task) {
+    for (uint8_t i = 0; i < tasksCount; ++i) {
+        if (tasks[i].task == task) return i;
+    }
+    return NO_TASK;
+}
+
+void FlightRecorder::step(__attribute__((unused)) Task *me) {
+    if (previous == NO_LOG) return;
+
+    const uint16_t items = 1 + state.logs[previous].count;
+    if (dumped < items) dumpNext();
+
+    // as fast as the telemetry class drains, like the trace export
+    const uint16_t messages = 1 + (state.logs[previous].count + EXPORT_CHUNK - 1) / EXPORT_CHUNK;
+    if (exported < messages && Connection::ready() && !Outbound::stats(Outbound::TELEMETRY).depth) {
+        if (exportNext()) ++exported;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_FLIGHT_RECORDER_H
+#define LETOVO_COMPUTERS_ARDUINO_FLIGHT_RECORDER_H
+
+#include <Arduino.h>
+#include <SoftTimer.h>
+
+#include "telemetry.h"
+
+// number of events kept per boot
+#define FLIGHT_RECORDER_EVENTS 32
+// a task callback running longer than this in ms is recorded
+#define FLIGHT_RECORDER_SLOW_MS 50
+
+// Post-mortem event log in .noinit RAM. Each boot writes into one of two logs, so after a warm reset (watchdog,
+// NVIC_SystemReset(), hard fault) the log of the previous boot is still there, together with the task that was in
+// its callback at the reset. begin() reads the reset cause, step() prints the previous log on the serial console and
+// publishes it to the telemetry topic once the broker is connected. A power cut loses both logs.
+namespace FlightRecorder {
+    enum Event : uint8_t {
+        BOOT       = 1,  // a: PM->RCAUSE, b: warm resets since the power-on
+        SLOW_TASK  = 2,  // a: task, b: run time in ms
+        CONNECTION = 3,  // a: Connection::State entered
+        PUBLISH    = 4,  // a: Outbound::Class delivered
+        DROP       = 5,  // a: Outbound::Class dropped
+        SCAN       = 6,  // a: reader, b: granted locally
+        FAULT      = 7,  // b: low half of the faulting PC, the whole one is in the report
+        WATCHDOG   = 8,  // a: task, b: ms it has been running or overdue
+        HEAP       = 9,  // b: bytes of an allocation refused after setup(), the caller is the pc of the report
+    };
+
+    const char *as_string(Event event);
+
+    // the most telling cause of the PM->RCAUSE bits, the watchdog first
+    const char *resetCause(uint8_t rcause);
+
+    // tasks are recorded by their index in the table, which has to outlive the recorder
+    void begin(const Telemetry::TaskInfo *tasks, uint8_t count);
+
+    void record(Event event, uint8_t a = 0, uint16_t b = 0);
+
+    // records an event that resets the device, pc is kept whole for the report
+    void fault(Event event, uint32_t pc, uint16_t b);
+
+    // warm resets since the power-on, 0 after a power-on
+    uint16_t resets();
+
+    // index of the task in the table, UINT8_MAX if it is not there
+    uint8_t taskIndex(const Task *task);
+
+    void step(Task *me);
+}
+
+#endif //LETOVO_COMPUTERS_ARDUINO_FLIGHT_RECORDER_H
@@ -0,0 +1,173 @@
+#include "heap.h"
+
+#include <malloc.h>
+
+#include "config.h"
+#include "flight_recorder.h"
+#include "pool.h"
+#include "telemetry.h"
+
+extern "C" {
+void *__real_malloc(size_t size);
+void __real_free(void *pointer);
+void *__real_realloc(void *pointer, size_t size);
+}
+
+namespace Heap {
+    static Pool<HEAP_SMALL_BLOCK, HEAP_SMALL_COUNT>   small;
+    static Pool<HEAP_MEDIUM_BLOCK, HEAP_MEDIUM_COUNT> medium;
+    static Pool<HEAP_LARGE_BLOCK, HEAP_LARGE_COUNT>   large;
+
+    static Stats stats_  = {};
+    static bool  sealed_ = false;
+
+    // bytes of the pool block the pointer is in, 0 if it is in the heap
+    static size_t blockBytes(const void *pointer) {
+        if (small.owns(pointer)) return small.BLOCK_BYTES;
+        if (medium.owns(pointer)) return medium.BLOCK_BYTES;
+        if (large.owns(pointer)) return large.BLOCK_BYTES;
+        return 0;
+    }
+
+    // the smallest free block the size fits in
+    static void *fromPools(size_t size) {
+        void *block = nullptr;
+
+        if (size <= small.BLOCK_BYTES) block = small.allocate();
+        if (!block && size <= medium.BLOCK_BYTES) block = medium.allocate();
+        if (!block && size <= large.BLOCK_BYTES) block = large.allocate();
+
+        return block;
+    }
+
+    static void counted(size_t bytes) {
+        ++stats_.allocations;
+        stats_.bytes += bytes;
+        if (stats_.bytes > stats_.peakBytes) stats_.peakBytes = stats_.bytes;
+    }
+
+    static void *allocate(size_t size, __attribute__((unused)) void *caller) {
+        if (sealed_) {
+            void *block = fromPools(size);
+            if (block) {
+                counted(blockBytes(block));
+                return block;
+            }
+
+#if HEAP_LOCKED
+            const uint16_t refused = uint16_t(min<size_t>(size, UINT16_MAX));
+            FlightRecorder::fault(FlightRecorder::HEAP, uint32_t(uintptr_t(caller)), refused);
+            NVIC_SystemReset();
+#endif
+            ++stats_.heapAllocations;
+        }
+
+        void *pointer = __real_malloc(size);
+        if (pointer) counted(malloc_usable_size(pointer));
+        return pointer;
+    }
+
+    static void release(void *pointer) {
+        if (!pointer) return;
+
+        ++stats_.frees;
+
+        if (small.owns(pointer)) {
+            stats_.bytes -= small.BLOCK_BYTES;
+            small.release(pointer);
+        } else if (medium.owns(pointer)) {
+            stats_.bytes -= medium.BLOCK_BYTES;
+            medium.release(pointer);
+        } else if (large.owns(pointer)) {
+            stats_.bytes -= large.BLOCK_BYTES;
+            large.release(pointer);
+        } else {
+            stats_.bytes -= malloc_usable_size(pointer);
+            __real_free(pointer);
+        }
+    }
+
+    static void *reallocate(void *pointer, size_t size, void *caller) {
+        if (!pointer) return allocate(size, caller);
+
+        if (!size) {
+            release(pointer);
+            return nullptr;
+        }
+
+        const size_t block    = blockBytes(pointer);
+        const size_t capacity = block ? block : malloc_usable_size(pointer);
+
+        // a String grows in small steps, most of them fit into what it has
+        if (size <= capacity) return pointer;
+
+        if (!block && !sealed_) {
+            void *resized = __real_realloc(pointer, size);
+            if (!resized) return nullptr;
+
+            stats_.bytes += malloc_usable_size(resized) - capacity;
+            if (stats_.bytes > stats_.peakBytes) stats_.peakBytes = stats_.bytes;
+            return resized;
+        }
+
+        void *moved = allocate(size, caller);
+        if (!moved) return nullptr;
+
+        memcpy(moved, pointer, capacity);
+        release(pointer);
+        return moved;
+    }
+}
+
+extern "C" {
+void *__wrap_malloc(size_t size) {
+    return Heap::allocate(size, __builtin_return_address(0));
+}
+
+void __wrap_free(void *pointer) {
+    Heap::release(pointer);
+}
+
+void *__wrap_realloc(void *pointer, size_t size) {
+    return Heap::reallocate(pointer, size, __builtin_return_address(0));
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    if (size && count > SIZE_MAX / size) return nullptr;
+
+    void *pointer = Heap::allocate(count * size, __builtin_return_address(0));
+    if (pointer) memset(pointer, 0, count * size);
+    return pointer;
+}
+}
+
+void Heap::seal() {
+    sealed_ = true;
+}
+
+bool Heap::sealed() { return sealed_; }
+
+uint32_t Heap::largestFree() {
+    uint32_t largest = Telemetry::heapGap();
+
+    if (large.used() < HEAP_LARGE_COUNT) largest = max<uint32_t>(largest, HEAP_LARGE_BLOCK);
+    else if (medium.used() < HEAP_MEDIUM_COUNT) largest = max<uint32_t>(largest, HEAP_MEDIUM_BLOCK);
+    else if (small.used() < HEAP_SMALL_COUNT) largest = max<uint32_t>(largest, HEAP_SMALL_BLOCK);
+
+    return largest;
+}
+
+const Heap::Stats &Heap::stats() { return stats_; }
+
+Heap::PoolStats Heap::poolStats(PoolIndex pool) {
+    switch (pool) {
+        case SMALL:
+            return {HEAP_SMALL_COUNT, small.used(), small.peak()};
+        case MEDIUM:
+            return {HEAP_MEDIUM_COUNT, medium.used(), medium.peak()};
+        case LARGE:
+            return {HEAP_LARGE_COUNT, large.used(), large.peak()};
+        default:
+            return {0, 0, 0};
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_HEAP_H
+#define LETOVO_COMPUTERS_ARDUINO_HEAP_H
+
+#include <Arduino.h>
+
+// Accounting of malloc()/free()/realloc()/calloc(), which are wrapped at link time (see platformio.ini), and the
+// fixed-block pools that serve them after setup(). The objects of setup() live as long as the device and stay in the
+// heap; everything allocated later (JSON nodes, Strings, stringified messages) is short-lived and goes to the pool of
+// the smallest block it fits in, so the heap does not fragment however long the device runs. An allocation that
+// fits no free block falls back to the heap and is counted, with HEAP_LOCKED it resets the device instead and the
+// flight recorder names the caller.
+namespace Heap {
+    enum PoolIndex : uint8_t {
+        SMALL  = 0,
+        MEDIUM = 1,
+        LARGE  = 2,
+        POOLS  = 3,
+    };
+
+    struct PoolStats {
+        uint16_t blocks;
+        uint16_t used;
+        uint16_t peak;
+    };
+
+    struct Stats {
+        uint32_t allocations;
+        uint32_t frees;
+        // bytes in use in the pools and in the heap, the heap ones as malloc_usable_size() tells
+        uint32_t bytes;
+        uint32_t peakBytes;
+        // allocations after seal() that the pools could not serve
+        uint32_t heapAllocations;
+    };
+
+    // the end of setup(): from here on the pools serve the allocations
+    void seal();
+
+    bool sealed();
+
+    // the largest block that can be allocated without touching the free chunks of the heap: the gap between the top
+    // of the heap and the stack, or a free pool block if that is larger
+    uint32_t largestFree();
+
+    const Stats &stats();
+
+    PoolStats poolStats(PoolIndex pool);
+}
+
+#endif //LETOVO_COMPUTERS_ARDUINO_HEAP_H
@@ -0,0 +1,108 @@
+#include "lifecycle.h"
+#include "config.h"
+#include "connection.h"
+#include "log.h"
+
+namespace Lifecycle {
+    struct Payload {
+        uint16_t length;
+        char     text[LIFECYCLE_PAYLOAD_MAX];
+    };
+
+    static MqttClient    *mqttClient = nullptr;
+    static MqttTransport *transport  = nullptr;
+
+    static Payload will  = {};
+    static Payload birth = {};
+
+    // the birth of the current connection is not acknowledged yet
+    static bool     birthPending = false;
+    // packet id of its latest attempt, 0 if it never made it to the wire
+    static uint16_t birthId      = 0;
+
+    static bool serialize(Payload &payload, const JSONVar &message) {
+        const String text = JSON.stringify(message);
+
+        if (text.length() >= LIFECYCLE_PAYLOAD_MAX) {
+            LOG_ERROR("## Lifecycle message is too long");
+            return false;
+        }
+
+        payload.length = text.length();
+        memcpy(payload.text, text.c_str(), payload.length + 1);
+        return true;
+    }
+
+    static bool applyWill() {
+        if (!mqttClient->beginWill(arduinoWillTopic, will.length, true, WILL_QOS)) {
+            LOG_ERROR("## Failed to begin will message");
+            return false;
+        }
+
+        mqttClient->write(reinterpret_cast<const uint8_t *>(will.text), will.length);
+        return mqttClient->endWill();
+    }
+
+    // the retry of a birth that went on the wire, as long as endMessage() waits for an acknowledgement
+    static bool republishBirth() {
+        if (!transport->republish(arduinoWillTopic, reinterpret_cast<const uint8_t *>(birth.text), birth.length, true,
+                                  WILL_QOS, birthId)) {
+            return false;
+        }
+
+        for (const unsigned long start = millis();
+             millis() - start < MQTT_ACK_TIMEOUT_MS && mqttClient->connected();) {
+            mqttClient->poll();
+
+            if (!transport->isInflight(birthId)) return true;
+        }
+        return false;
+    }
+
+    // Published right away instead of through the outbound queues: queued on every reconnect, it would push the SCANs
+    // that waited out the outage out of the interactive queue. An ack timeout leaves the connection up, and a broker
+    // holds a QoS 2 message until its PUBREL, so the birth is retried until it is acknowledged.
+    static void publishBirth() {
+        if (birthId) {
+            // acknowledged after endMessage() gave up waiting
+            if (!transport->isInflight(birthId) || republishBirth()) birthPending = false;
+        } else if (mqttClient->beginMessage(arduinoWillTopic, birth.length, true, WILL_QOS)) {
+            const uint16_t lastPublishId = transport->lastPublishId();
+
+            mqttClient->write(reinterpret_cast<const uint8_t *>(birth.text), birth.length);
+            if (mqttClient->endMessage()) {
+                birthPending = false;
+            } else if (transport->lastPublishId() != lastPublishId) {
+                birthId = transport->lastPublishId();
+            }
+        } else {
+            LOG_ERROR("## Failed to begin birth message");
+        }
+
+        if (birthPending) LOG_WARN("## Birth message was not acknowledged, retrying");
+    }
+}
+
+void Lifecycle::begin(MqttClient &client, MqttTransport &clientTransport, const JSONVar &willMessage,
+                      const JSONVar &birthMessage) {
+    mqttClient = &client;
+    transport  = &clientTransport;
+
+    serialize(birth, birthMessage);
+    if (serialize(will, willMessage)) applyWill();
+}
+
+void Lifecycle::onConnected() {
+    if (!birth.length) return;
+
+    // the birth of a previous connection is superseded by this one
+    transport->forget(birthId);
+    birthId      = 0;
+    birthPending = true;
+
+    publishBirth();
+}
+
+void Lifecycle::step(__attribute__((unused)) Task *me) {
+    if (birthPending && Connection::ready()) publishBirth();
+}
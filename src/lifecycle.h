@@ -0,0 +1,26 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_LIFECYCLE_H
+#define LETOVO_COMPUTERS_ARDUINO_LIFECYCLE_H
+
+#include <ArduinoMqttClient.h>
+#include <Arduino_JSON.h>
+#include <SoftTimer.h>
+
+#include "transport.h"
+
+// max length of a serialized will or birth message
+#define LIFECYCLE_PAYLOAD_MAX 160
+
+// Presence of the device on the will topic. The will (DISCONNECT) is handed to the client once and sent by the broker
+// when the connection is lost, the birth (CONNECT) is published retained right after every connect and replaces it.
+// Both are serialized once. A birth that is not acknowledged is sent again by step() until it is, under its packet id.
+namespace Lifecycle {
+    void begin(MqttClient &client, MqttTransport &transport, const JSONVar &will, const JSONVar &birth);
+
+    // to be called every time the connection is ready, publishes the birth
+    void onConnected();
+
+    // retries the birth of the current connection
+    void step(Task *me);
+}
+
+#endif //LETOVO_COMPUTERS_ARDUINO_LIFECYCLE_H
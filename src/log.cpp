@@ -0,0 +1,97 @@
+#include "log.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+namespace Log {
+    static_assert(LOG_LINE_MAX < 256, "the length of a record is stored in a byte");
+
+    // records are a length byte followed by the text, without a line end
+    static uint8_t  ring[LOG_BUFFER_BYTES];
+    static uint16_t head = 0;
+    static uint16_t used = 0;
+
+    static Stats    stats_ = {};
+    // dropped since the latest notice
+    static uint32_t unreported = 0;
+
+    static uint8_t at(uint16_t offset) {
+        return ring[(head + offset) % LOG_BUFFER_BYTES];
+    }
+
+    static void push(const char *text, uint8_t length) {
+        uint16_t tail = (head + used) % LOG_BUFFER_BYTES;
+
+        ring[tail] = length;
+        for (uint8_t i = 0; i < length; ++i) {
+            tail = (tail + 1) % LOG_BUFFER_BYTES;
+            ring[tail] = uint8_t(text[i]);
+        }
+
+        used += 1 + length;
+        stats_.peakBytes = max(stats_.peakBytes, used);
+    }
+
+    // writes the oldest record, returns its size on the wire
+    static uint16_t drain() {
+        const uint8_t length = at(0);
+
+        char    chunk[32];
+        uint8_t filled = 0;
+        for (uint8_t i = 1; i <= length; ++i) {
+            chunk[filled++] = char(at(i));
+            if (filled == sizeof(chunk)) {
+                Serial.write(chunk, filled);
+                filled = 0;
+            }
+        }
+        Serial.write(chunk, filled);
+        Serial.write("\r\n", 2);
+
+        head = (head + 1 + length) % LOG_BUFFER_BYTES;
+        used -= 1 + length;
+        return length + 2;
+    }
+}
+
+void Log::write(const char *format, ...) {
+    char line[LOG_LINE_MAX + 1];
+
+    va_list args;
+    va_start(args, format);
+    const int formatted = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    if (formatted < 0) return;
+
+    const auto length = uint8_t(min(formatted, LOG_LINE_MAX));
+    if (used + 1 + length > LOG_BUFFER_BYTES) {
+        ++stats_.dropped;
+        ++unreported;
+        return;
+    }
+
+    push(line, length);
+    ++stats_.written;
+}
+
+void Log::step(__attribute__((unused)) Task *me) {
+    // no USB host: the records wait for one. Not `!Serial`, on SAMD it delays for 10 ms on every call.
+    if (!Serial.dtr()) return;
+
+    // the USB serial port reports a free packet even while the previous one is in flight, so the bytes per step are
+    // bounded as well: a record waits at most for a packet or two
+    for (uint16_t sent = 0; used && sent < LOG_DRAIN_BYTES && Serial.availableForWrite() > 0;) sent += drain();
+
+    if (!unreported) return;
+
+    char          line[40];
+    const auto    count  = (unsigned long) unreported;
+    const uint8_t length = uint8_t(snprintf(line, sizeof(line), "# %lu log records dropped", count));
+    if (used + 1 + length > LOG_BUFFER_BYTES) return;
+
+    push(line, length);
+    unreported = 0;
+}
+
+const Log::Stats &Log::stats() { return stats_; }
@@ -0,0 +1,69 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_LOG_H
+#define LETOVO_COMPUTERS_ARDUINO_LOG_H
+
+#include <Arduino.h>
+#include <SoftTimer.h>
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+// records above this level are not compiled in, their arguments are not even evaluated
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// size of the ring buffer of formatted records in bytes
+#define LOG_BUFFER_BYTES 1024
+// longest record, longer ones are cut
+#define LOG_LINE_MAX 120
+// bytes written to the serial port per step, a record is never split
+#define LOG_DRAIN_BYTES 128
+
+// Diagnostics without blocking: a record is formatted into a RAM ring buffer right away, and step() copies the oldest
+// records to the serial port, a bounded number of bytes per step. A record that does not fit into the ring is dropped
+// and counted, the count is printed when there is room again. Records stay in the ring while no USB host is attached,
+// so the boot is still there to read when one attaches. Not for interrupt handlers.
+namespace Log {
+    struct Stats {
+        uint32_t written;
+        uint32_t dropped;
+        // peak number of bytes in the ring
+        uint16_t peakBytes;
+    };
+
+    // printf-like, without floating point; use the LOG_* macros, they strip the disabled levels
+    void write(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+    void step(Task *me);
+
+    const Stats &stats();
+}
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) Log::write(__VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) Log::write(__VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) Log::write(__VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) Log::write(__VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+#endif //LETOVO_COMPUTERS_ARDUINO_LOG_H
@@ -1,10 +1,10 @@
 #include <Arduino.h>
 #include <Arduino_JSON.h>
-#include <rdm6300.h>
-#include <Servo.h>
 #include <WiFiNINA.h>
 #include <ArduinoMqttClient.h>
 #include <SoftTimer.h>
+#include <DelayRun.h>
+#include <wiring_private.h>
 
 #if USE_SSL
 #include <ArduinoBearSSL.h>
@@ -14,53 +14,150 @@
 
 #include "main.h"
 #include "config.h"
+#include "connection.h"
+#include "transport.h"
+#include "tls_session.h"
+#include "dispatch.h"
+#include "outbound.h"
+#include "telemetry.h"
+#include "lifecycle.h"
+#include "auth_cache.h"
+#include "rfid.h"
+#include "tag_directory.h"
+#include "trace.h"
+#include "door.h"
+#include "boot.h"
+#include "settings.h"
+#include "console.h"
+#include "log.h"
+#include "flight_recorder.h"
+#include "watchdog.h"
+#include "heap.h"
+
+// slots occupied at the previous scan of the key matrix, bit (row * COLS + col)
+static uint32_t slotsPressedOld = 0;
 
-static String statusMessage;
-
-unsigned int (*statusMessageLength)() = []() { return statusMessage.length(); };
-
-static std::set<const char *>    buttonsPressed;
-static std::set<const char *>    buttonsPressedOld;
-static std::vector<const char *> buttonsToUp;
-static std::vector<const char *> buttonsToDown;
-
-Servo      servo;
-Rdm6300    rdm6300;
 WiFiClient wifiClient;
 #if !USE_SSL
-MqttClient mqttClient(wifiClient);
+MqttTransport transport(wifiClient);
+MqttClient    mqttClient(transport);
 #endif
 #if USE_SSL
 //WiFiSSLClient wifiClient;
 BearSSLClient sslClient(wifiClient);
-MqttClient mqttClient(sslClient);
+MqttTransport transport(sslClient);
+MqttClient    mqttClient(transport);
 const int keySlot = 0;  // Crypto chip slot to pick the key from
 const int certSlot = 8;  // Crypto chip slot to pick the certificate from
 #endif
 
-Task checkWiFiConnectionTask(10000, checkWiFiConnection);
-Task checkBrokerConnectionTask(10000, checkBrokerConnection);
+#if RFID_READERS > 1
+// reader 1 on SERCOM0: RX on A2 (PA11, pad 3); TX on A3 (PA10, pad 2) is not connected but required by Uart
+Uart rfidUart1(&sercom0, A2, A3, SERCOM_RX_PAD_3, UART_TX_PAD_2);
+
+void SERCOM0_Handler() {
+    rfidUart1.IrqHandler();
+}
+#endif
+
+static_assert(RFID_READERS >= 1 && RFID_READERS <= 2, "the free pins of the board allow for two readers only");
+
+// UART of each RDM6300, reader 0 is on Serial1 (SERCOM5, RX on D0)
+static HardwareSerial *const rfidSerials[RFID_READERS] = {
+        &Serial1,
+#if RFID_READERS > 1
+        &rfidUart1,
+#endif
+};
+
+// incoming commands indexed by the status code, codes that are only sent by the device have no handler
+static constexpr Dispatch::Command commands[] = {
+        {uint8_t(Status::Value::PLACE),         Dispatch::NO_TOPIC,      Dispatch::NO_FIELDS, nullptr},
+        {uint8_t(Status::Value::TAKE),          Dispatch::NO_TOPIC,      Dispatch::NO_FIELDS, nullptr},
+        {uint8_t(Status::Value::SCAN),          Dispatch::NO_TOPIC,      Dispatch::NO_FIELDS, nullptr},
+        {uint8_t(Status::Value::DISCONNECT),    Dispatch::ANY_TOPIC,     Dispatch::MESSAGE,   Status::handleDisconnect},
+        {uint8_t(Status::Value::CONNECT),       Dispatch::ANY_TOPIC,     Dispatch::MESSAGE,   Status::handleConnect},
+        {uint8_t(Status::Value::OPEN),          Dispatch::SERVER_STREAM, Dispatch::MESSAGE,   Status::handleOpen},
+        {6,                                     Dispatch::NO_TOPIC,      Dispatch::NO_FIELDS, nullptr},
+        {uint8_t(Status::Value::ERROR_OCCUR),   Dispatch::SERVER_STREAM, Dispatch::MESSAGE,   Status::handleErrorOccur},
+        {uint8_t(Status::Value::ERROR_RESOLVE), Dispatch::SERVER_STREAM, Dispatch::MESSAGE,   Status::handleErrorResolve},
+        {uint8_t(Status::Value::SNAPSHOT),      Dispatch::SERVER_STREAM, Dispatch::NO_FIELDS, Status::handleSnapshot},
+        {uint8_t(Status::Value::AUTH),          Dispatch::SERVER_STREAM, Dispatch::NO_FIELDS, Status::handleAuth},
+        {uint8_t(Status::Value::TAGS),          Dispatch::SERVER_STREAM, Dispatch::NO_FIELDS, Status::handleTags},
+        {uint8_t(Status::Value::TRACE),         Dispatch::SERVER_STREAM, Dispatch::NO_FIELDS, Status::handleTrace},
+        {uint8_t(Status::Value::DOOR),          Dispatch::NO_TOPIC,      Dispatch::NO_FIELDS, nullptr},
+        {uint8_t(Status::Value::CONFIG),        Dispatch::SERVER_STREAM, Dispatch::NO_FIELDS, Status::handleConfig},
+};
+
+static_assert(Dispatch::isIndexed(commands), "commands must be indexed by the status code");
+static_assert(sizeof(commands) / sizeof(commands[0]) <= Dispatch::COMMANDS_MAX, "too many commands");
+
+Task connectionTask(CONNECTION_STEP_MS, Connection::step);
 Task listenForRFIDTask(10, listenForRFID);
 Task listenForButtonsTask(500, listenForButtons);
 Task MQTTPollTask(10, MQTTPoll);
+Task outboundTask(OUTBOUND_STEP_MS, Outbound::step);
+Task lifecycleTask(LIFECYCLE_STEP_MS, Lifecycle::step);
+Task publishSnapshotTask(SNAPSHOT_INTERVAL_MS, publishSnapshot);
+Task telemetryTask(TELEMETRY_INTERVAL_MS, Telemetry::publish);
+Task tagDirectoryTask(TAG_DIRECTORY_STEP_MS, TagDirectory::step);
+Task traceTask(TRACE_STEP_MS, Trace::step);
+Task consoleTask(CONSOLE_STEP_MS, Console::step);
+Task logTask(LOG_STEP_MS, Log::step);
+Task flightRecorderTask(FLIGHT_RECORDER_STEP_MS, FlightRecorder::step);
+DelayRun rebootTask(CONFIG_REBOOT_DELAY_MS, reboot);
+
+// tasks whose run time is reported in the telemetry
+static const Telemetry::TaskInfo telemetryTasks[] = {
+        {"conn",  &connectionTask},
+        {"rfid",  &listenForRFIDTask},
+        {"keys",  &listenForButtonsTask},
+        {"poll",  &MQTTPollTask},
+        {"out",   &outboundTask},
+        {"life",  &lifecycleTask},
+        {"snap",  &publishSnapshotTask},
+        {"telem", &telemetryTask},
+        {"tags",  &tagDirectoryTask},
+        {"trace", &traceTask},
+        {"door",  &Door::task()},
+        {"cons",  &consoleTask},
+        {"log",   &logTask},
+};
+
+static_assert(sizeof(telemetryTasks) / sizeof(telemetryTasks[0]) <= TELEMETRY_TASKS_MAX,
+              "telemetryTasks does not fit into TELEMETRY_TASKS_MAX");
+
+// execution budgets and deadlines of the tasks the device is useless without, and of the others that block longer
+// than WATCHDOG_BUDGET_MS
+static const Watchdog::Budget watchdogBudgets[] = {
+        {&connectionTask,    WATCHDOG_CONNECT_BUDGET_MS, WATCHDOG_DEADLINE_MS},
+        {&listenForRFIDTask, WATCHDOG_BUDGET_MS,         WATCHDOG_DEADLINE_MS},
+        {&MQTTPollTask,      WATCHDOG_BUDGET_MS,         WATCHDOG_DEADLINE_MS},
+        {&outboundTask,      WATCHDOG_PUBLISH_BUDGET_MS, WATCHDOG_DEADLINE_MS},
+        // not critical, the birth is retried until it gets through, but it blocks as long as the outbound step
+        {&lifecycleTask,     WATCHDOG_PUBLISH_BUDGET_MS, 0},
+};
+
+// called by the core from the SysTick interrupt every millisecond, returning 0 keeps the default tick handling
+extern "C" int sysTickHook() {
+    Rfid::tick();
+    Watchdog::tick();
+    return 0;
+}
 
 __attribute__((unused)) void setup() {
-    // init serial
+    Boot::mark(Boot::SETUP);
+
+    // init serial, without waiting for a USB host: a deployed device has none, the output is lost until one attaches
     Serial.begin(9600);
-    while (!Serial);
 
-#if USE_SSL
-    Serial.println("Using the certificate from config.h...");
-    sslClient.setKey(PRIVATE_KEY, CERTIFICATE);
+    // the log of the previous boot is kept from here on, and the task dispatches are recorded
+    FlightRecorder::begin(telemetryTasks, sizeof(telemetryTasks) / sizeof(telemetryTasks[0]));
 
-     Instruct the SSL client to use the chosen ECCX08 slot for picking the private key
-     and set the hardcoded certificate as accompanying public certificate.
-    //sslClient.setEccCert();  // DER
-    //        bearClient.setEccSlot(
-    //                keySlot,
-    //                CLIENT_CERT);
-#endif
+    // the network settings saved in flash, before anything reads them
+    Settings::begin();
 
+    // the inputs come first, a scan or a slot change is captured from the first scheduler round on
     // init LED
     pinMode(LED_PIN, OUTPUT);
     digitalWrite(LED_PIN, HIGH);
@@ -75,210 +172,220 @@ __attribute__((unused)) void setup() {
         pinMode(colPin, INPUT_PULLUP);
     }
 
-    // init Servo
-    pinMode(SERVO_PIN, OUTPUT);
-    servo.attach(SERVO_PIN);
+    // init RFID scanners (RDM6300), the frames are received in the background from now on
+    Rfid::begin(rfidSerials, RFID_READERS);
+#if RFID_READERS > 1
+    // Uart::begin() muxes A2/A3 the way the variant describes them, i.e. as analog inputs
+    pinPeripheral(A2, PIO_SERCOM);
+    pinPeripheral(A3, PIO_SERCOM);
+#endif
+    LOG_INFO("# listening for RFID tags nearby...");
 
-    // connect to the Internet
-    statusMessage = "# connecting to " + String(wifiSSID);
-    while (WiFi.status() != WL_CONNECTED) {
-        connectToInternet();
-        delay(2000);
-    }
-    Serial.print("\n## Connected to the Internet. IP address: ");
-    Serial.println(WiFi.localIP());
+    // init the door, the servo is only attached while it moves
+    Door::begin(SERVO_PIN, onDoorChange);
+
+    Boot::mark(Boot::INPUTS);
+
+    Telemetry::begin(telemetryTasks, sizeof(telemetryTasks) / sizeof(telemetryTasks[0]));
 
-    // init the MQTT broker & client and connect to the broker
+#if USE_SSL
+    LOG_INFO("Using the certificate from config.h...");
+    sslClient.setKey(PRIVATE_KEY, CERTIFICATE);
+
+    // Instruct the SSL client to use the chosen ECCX08 slot for picking the private key
+    // and set the hardcoded certificate as accompanying public certificate.
+    //sslClient.setEccCert();  // DER
+    //        bearClient.setEccSlot(
+    //                keySlot,
+    //                CLIENT_CERT);
+
+    TlsSession::begin(transport);
+#endif
+
+    // init the MQTT client, the connection itself is made by connectionTask in the background,
+    // messages of the events until then wait in the outbound queues
     mqttClient.setId(clientID);
     mqttClient.setUsernamePassword(brokerUser, brokerPass);
 
-    statusMessage = "# connecting to the broker";
-    while (!connectToBroker() && WiFi.status() == WL_CONNECTED) {
-        delay(1000);
-    }
-    if (WiFi.status() != WL_CONNECTED) {
-        Serial.println("## Wi-Fi connection lost during setup. Restarting...");
-        NVIC_SystemReset();
-    }
+    // presence on the will topic: DISCONNECT set as the will, CONNECT published retained after every connect
+    Lifecycle::begin(mqttClient, transport, createMessage(Status::Value::DISCONNECT, "", ""),
+                     createMessage(Status::Value::CONNECT, "", ""));
 
-    sendWillMessage(willPayload);
+    Connection::begin(mqttClient, transport, onConnectionReady);
+    // the flight recorder counts the boots since the power-on, that tells the snapshot numbers of the boots apart
+    Outbound::begin(mqttClient, transport, onMessageDropped, FlightRecorder::resets());
 
     mqttClient.onMessage([](__attribute__((unused)) int messageSize) {
-        Serial.print("## Got a message on topic: ");
-        Serial.println(mqttClient.messageTopic());
+        const String topic = mqttClient.messageTopic();
+
+        LOG_DEBUG("## Got a message on topic: %s", topic.c_str());
 
         while (mqttClient.available()) {
             JSONVar message = JSON.parse(mqttClient.readString());
 
-            switch (static_cast<Status::Value>(int(message["status"]))) {
-                case Status::Value::ERROR_OCCUR:
-                    Status::handleErrorOccur(message);
-                    break;
-                case Status::Value::ERROR_RESOLVE:
-                    Status::handleErrorResolve(message);
-                    break;
-                case Status::Value::CONNECT:
-                    Status::handleConnect(message);
-                    break;
-                case Status::Value::DISCONNECT:
-                    Status::handleDisconnect(message);
-                    break;
-                case Status::Value::OPEN:
-                    Status::handleOpen(message);
-                    break;
-                default:
-                    Serial.println("[unknown status]: ");
-                    Serial.println(message);
-                    break;
-            }
+            Dispatch::dispatch(commands, sizeof(commands) / sizeof(commands[0]), topic.c_str(), message);
         }
     });
 
-    // init RFID scanner (RDM6300)
-    rdm6300.begin(RDM6300_RX_PIN);
-    Serial.println("# listening for RFID tags nearby...");
+    TagDirectory::begin(onTagDirectoryCommit);
 
-    // add Tasks to the scheduler (SoftTimer)
+    // add Tasks to the scheduler (SoftTimer), the inputs first so they run before the first Wi-Fi call
     for (Task *task: {
-            &checkWiFiConnectionTask, &checkBrokerConnectionTask,
-            &listenForRFIDTask, &listenForButtonsTask, &MQTTPollTask
+            &listenForRFIDTask, &listenForButtonsTask,
+            &connectionTask, &MQTTPollTask, &outboundTask, &lifecycleTask,
+            &publishSnapshotTask, &telemetryTask, &tagDirectoryTask, &traceTask, &consoleTask, &logTask,
+            &flightRecorderTask
     }) {
         SoftTimer.add(task);
     }
-}
 
-void checkWiFiConnection(__attribute__((unused)) Task *me) {
-    if (WiFi.status() == WL_CONNECTED) return;
+    Boot::mark(Boot::SCHEDULED);
 
-    Serial.println("## Lost connection to the Internet");
+    // what setup() allocated stays for good, the allocations of the tasks go to the pools
+    Heap::seal();
 
-    statusMessage = "# reconnecting to " + String(wifiSSID);
-    while (WiFi.status() != WL_CONNECTED) {
-        connectToInternet();
-        delay(2000);
-    }
+    // from here on a hung task resets the device
+    Watchdog::begin(watchdogBudgets, sizeof(watchdogBudgets) / sizeof(watchdogBudgets[0]));
+}
+
+void onConnectionReady() {
+#if USE_SSL
+    TlsSession::benchmarkStep(mqttClient);
+#endif
+
+    Lifecycle::onConnected();
 
-    Serial.print("\n## Reconnected to the Internet. IP address: ");
-    Serial.println(WiFi.localIP());
+    // the server might have missed deltas while we were offline
+    publishSnapshot(nullptr);
 }
 
-void checkBrokerConnection(__attribute__((unused)) Task *me) {
-    if (mqttClient.connected()) return;
+void listenForRFID(__attribute__((unused)) Task *me) {
+    uint8_t  reader;
+    uint32_t newTag;
+    uint32_t capturedAt;
+    if (Rfid::nextTag(reader, newTag, capturedAt)) {
+        const uint16_t trace = Trace::start(Trace::SCAN, capturedAt);
+
+        itoa(int(newTag), latestRFID, 16);
 
-    Serial.println("## Lost connection to the broker");
+        LOG_INFO("## New tag scanned on reader %u: %s", unsigned(reader), latestRFID);
 
-    statusMessage = "# reconnecting to the broker";
-    while (!connectToBroker() && WiFi.status() == WL_CONNECTED) {
-        delay(1000);
+        // a known tag opens the door right away, the server learns about it from the SCAN
+        const bool granted = !Status::ERROR_OCCURRED && (AuthCache::allowed(newTag) || TagDirectory::contains(newTag));
+        FlightRecorder::record(FlightRecorder::SCAN, reader, granted);
+        if (granted) {
+            Door::open();
+            Trace::mark(trace, Trace::ACTUATED);
+        }
+
+        JSONVar scan = createMessage(Status::Value::SCAN);
+        scan["granted"] = granted;
+        scan["reader"]  = reader;
+        scan["trace"]   = trace;
+
+        sendMessage(Outbound::INTERACTIVE, arduinoStreamTopic, scan, false, trace);
     }
 
-    if (WiFi.status() != WL_CONNECTED) return;
+    bool tagPresent = false;
+    for (uint8_t i = 0; i < Rfid::readers(); ++i) tagPresent |= Rfid::currentTag(i) != 0;
 
-    Serial.print("## Reconnected to the broker. Client ID: ");
-    Serial.println(clientID);
+    digitalWrite(LED_PIN, tagPresent ? HIGH : LOW);
 }
 
-void listenForRFID(__attribute__((unused)) Task *me) {
-    if (uint32_t newTag = rdm6300.get_new_tag_id()) {
-        itoa(int(newTag), latestRFID, 16);
+void slotList(uint32_t slots, char *text, size_t size) {
+    size_t length = 0;
+    text[0] = '\0';
 
-        Serial.print("## New tag scanned: ");
-        Serial.println(latestRFID);
+    for (uint8_t slot = 0; slot < ROWS * COLS; ++slot) {
+        if (!(slots & 1UL << slot)) continue;
 
-        sendWillMessage(createMessage(Status::Value::DISCONNECT));
-        sendMessage(arduinoStreamTopic, createMessage(Status::Value::SCAN));
-    }
+        const char   *id       = SLOT_IDS[slot / COLS][slot % COLS];
+        const size_t idLength = strlen(id);
+        if (length + idLength + 2 > size) break;
 
-    digitalWrite(LED_PIN, int(rdm6300.get_tag_id()));
+        memcpy(text + length, id, idLength);
+        length += idLength;
+        text[length++] = ';';
+        text[length]   = '\0';
+    }
 }
 
 void listenForButtons(__attribute__((unused)) Task *me) {
-    using namespace SetSubtract;
+    // the edges are only seen by this scan, so its start is the capture time of the slot changes
+    const uint32_t capturedAt    = micros();
+    uint32_t       occupiedSlots = 0;
 
     for (uint8_t row = 0; row < ROWS; ++row) {
         digitalWrite(ROW_PINS[row], LOW);
 
         for (uint8_t col = 0; col < COLS; ++col) {
             if (!digitalRead(COL_PINS[col])) {
-                buttonsPressed.emplace(SLOT_IDS[row][col]);
+                occupiedSlots |= 1UL << (row * COLS + col);
             }
         }
 
         digitalWrite(ROW_PINS[row], HIGH);
     }
 
-    buttonsToUp   = buttonsPressedOld - buttonsPressed;
-    buttonsToDown = buttonsPressed - buttonsPressedOld;
+    const uint32_t slotsDown = occupiedSlots & ~slotsPressedOld;
+    const uint32_t slotsUp   = slotsPressedOld & ~occupiedSlots;
 
-    if (!buttonsToDown.empty()) {
-        String          slots;
-        for (const char *button: buttonsToDown) {
-            slots += button + String(';');
-        }
+    if (slotsDown) {
+        char slots[SLOT_LIST_MAX];
+        slotList(slotsDown, slots, sizeof(slots));
 
-        Serial.print("## Buttons pressed: ");
-        Serial.println(slots);
+        LOG_INFO("## Buttons pressed: %s", slots);
 
-        sendMessage(arduinoStreamTopic, createMessage(Status::Value::PLACE, slots.c_str()));
-    }
-
-    if (!buttonsToUp.empty()) {
-        String          slots;
-        for (const char *button: buttonsToUp) {
-            slots += button + String(';');
-        }
+        const uint16_t trace = Trace::start(Trace::SLOT, capturedAt);
 
-        Serial.print("## Buttons released: ");
-        Serial.println(slots);
+        JSONVar place = createMessage(Status::Value::PLACE, slots);
+        place["trace"] = trace;
 
-        sendMessage(arduinoStreamTopic, createMessage(Status::Value::TAKE, slots.c_str()));
+        sendMessage(Outbound::INVENTORY, arduinoStreamTopic, place, false, trace, Outbound::DELTA);
     }
 
-    buttonsPressedOld = buttonsPressed;
-    buttonsPressed.clear();
-    buttonsToUp.clear();
-    buttonsToDown.clear();
-}
+    if (slotsUp) {
+        char slots[SLOT_LIST_MAX];
+        slotList(slotsUp, slots, sizeof(slots));
 
-void MQTTPoll(__attribute__((unused)) Task *me) { mqttClient.poll(); }
+        LOG_INFO("## Buttons released: %s", slots);
 
-bool connectToBroker() {
-    Serial.print('\r');
-    Serial.print(RepeatedString(" ", statusMessageLength()));
-    Serial.print("\rMOTT connection failed. Error no: ");
-    Serial.println(mqttClient.connectError());
-    Serial.print(statusMessage);
-    Serial.flush();
+        const uint16_t trace = Trace::start(Trace::SLOT, capturedAt);
 
-    if (!mqttClient.connect(brokerHost, brokerPort)) {
-        return false;
+        JSONVar take = createMessage(Status::Value::TAKE, slots);
+        take["trace"] = trace;
+
+        sendMessage(Outbound::INVENTORY, arduinoStreamTopic, take, false, trace, Outbound::DELTA);
     }
 
-    Serial.print("\n## Connected to the broker. Client ID: ");
-    Serial.println(clientID);
+    Snapshot::slots = occupiedSlots;
+    slotsPressedOld = occupiedSlots;
+}
 
-    for (const char *const &topic: {serverStreamTopic, serverWillTopic}) {
-        if (mqttClient.subscribe(topic)) {
-            Serial.print("## Subscribed to ");
-            Serial.println(topic);
-        } else {
-            Serial.print("## Failed to subscribe to ");
-            Serial.println(topic);
-        }
-    }
+void MQTTPoll(__attribute__((unused)) Task *me) {
+    if (Connection::ready()) mqttClient.poll();
+}
 
-    return true;
+void publishSnapshot(__attribute__((unused)) Task *me) {
+    // a snapshot still waiting in the queue is outdated by this one, so it is replaced. Outbound numbers it when it
+    // goes on the wire, and the deltas behind it in the same class are numbered from it.
+    sendMessage(Outbound::INVENTORY, arduinoSnapshotTopic, createSnapshot(), true, 0, Outbound::SNAPSHOT);
 }
 
-void connectToInternet() {
-    Serial.print('\r');
-    Serial.print(RepeatedString(" ", statusMessageLength()));
-    Serial.print("\rWi-Fi status: ");
-    Serial.println(WiFi.status());
-    Serial.print(statusMessage);
-    Serial.flush();
+void onMessageDropped(Outbound::Class cls) {
+    // the server cannot rebuild the state from the deltas anymore
+    if (cls == Outbound::INVENTORY) publishSnapshot(nullptr);
+}
+
+void onTagDirectoryCommit(uint32_t version, bool ok) {
+    JSONVar ack;
+    ack["status"]  = int(Status::Value::TAGS);
+    ack["message"] = Status::as_string(Status::Value::TAGS);
+    ack["version"] = double(ok ? version : TagDirectory::stats().version);
+    ack["count"]   = TagDirectory::stats().count;
+    ack["ok"]      = ok;
 
-    WiFi.begin(wifiSSID, wifiPass);
+    sendMessage(Outbound::INVENTORY, arduinoStreamTopic, ack);
 }
 
 JSONVar createMessage(Status::Value status, const char *slots, const char *tag) {
@@ -296,7 +403,7 @@ JSONVar createMessage(Status::Value status, const char *slots, const char *tag)
     // WARNING: could cause undefined behavior if the order of the members is changed
     auto            pField = reinterpret_cast<const char **>(&payload);
     for (const char *fieldName: memberNames) {
-        Serial.println(*pField);
+        LOG_DEBUG("%s", *pField);
         payloadObject[fieldName] = *pField++;
     }
 #endif
@@ -310,75 +417,190 @@ JSONVar createMessage(Status::Value status, const char *slots, const char *tag)
     return payloadObject;
 }
 
-int sendMessage(const char *topic, const JSONVar &message) {
-    if (!mqttClient.beginMessage(topic, true, 2)) {
-        Serial.println("## Failed to begin message");
+JSONVar createSnapshot() {
+    JSONVar snapshotObject;
 
-        return 0;
-    }
+    uint8_t state = 0;
+    if (Status::SERVER_CONNECTED) state |= Snapshot::SERVER_CONNECTED;
+    if (Status::ERROR_OCCURRED) state |= Snapshot::ERROR_OCCURRED;
+    if (Door::state() != Door::CLOSED) state |= Snapshot::DOOR_OPEN;
+
+    snapshotObject["status"] = int(Status::Value::SNAPSHOT);
+    snapshotObject["slots"]  = double(Snapshot::slots);
+    snapshotObject["RFID"]   = latestRFID;
+    snapshotObject["state"]  = state;
 
-    mqttClient.print(message);
-    return mqttClient.endMessage();
+    return snapshotObject;
 }
 
-int sendWillMessage(const JSONVar &message) {
-    if (mqttClient.beginWill(arduinoWillTopic, true, 2)) {
-        Serial.println("## Failed to begin will message");
+bool sendMessage(Outbound::Class cls, const char *topic, const JSONVar &message, bool merge, uint16_t trace,
+                 Outbound::Sequence sequence) {
+    return Outbound::enqueue(cls, topic, JSON.stringify(message).c_str(), true, merge, trace, sequence);
+}
 
-        return 0;
-    }
+void onDoorChange(Door::State state) {
+    LOG_INFO("## Door %s", Door::as_string(state));
+
+    JSONVar door = createMessage(Status::Value::DOOR);
+    door["door"] = Door::as_string(state);
 
-    mqttClient.print(JSON.stringify(message));
-    return mqttClient.endWill();
+    // the deltas are numbered in the inventory class alone, its queue keeps them in order
+    sendMessage(Outbound::INVENTORY, arduinoStreamTopic, door, false, 0, Outbound::DELTA);
 }
 
-// if isOpen is true, open the door, else close it
-void openDoor(bool isOpen) {
-    if (isOpen)
-        servo.write(0);
-    else
-        servo.write(90);
+boolean reboot(__attribute__((unused)) Task *me) {
+    // the log is not drained anymore, this goes out at once
+    Serial.println("## Rebooting");
+    Serial.flush();
+    NVIC_SystemReset();
+    return false;
 }
 
 void Status::handleErrorOccur(const JSONVar &MQTTMessage) {
     Status::ERROR_OCCURRED = true;
 
-    Serial.print("[");
-    Serial.print(Status::as_string(Status::Value::ERROR_OCCUR));
-    Serial.print("]: ");
-    Serial.println(MQTTMessage["message"]);
+    LOG_WARN("[%s]: %s", Status::as_string(Status::Value::ERROR_OCCUR), (const char *) MQTTMessage["message"]);
 }
 
 void Status::handleErrorResolve(const JSONVar &MQTTMessage) {
     Status::ERROR_OCCURRED = false;
 
-    Serial.print("[");
-    Serial.print(Status::as_string(Status::Value::ERROR_RESOLVE));
-    Serial.print("]: ");
-    Serial.println(MQTTMessage["message"]);
+    LOG_INFO("[%s]: %s", Status::as_string(Status::Value::ERROR_RESOLVE), (const char *) MQTTMessage["message"]);
 }
 
 void Status::handleOpen(const JSONVar &MQTTMessage) {
+    // the server may echo the trace of the SCAN, otherwise the OPEN belongs to the latest scan waiting for one
+    const uint16_t trace = JSON.typeof(MQTTMessage["trace"]) == "number"
+                           ? uint16_t(int(MQTTMessage["trace"]))
+                           : Trace::pending(Trace::SCAN, Trace::OPEN_RECEIVED);
+    Trace::mark(trace, Trace::OPEN_RECEIVED);
+
     if (!Status::SERVER_CONNECTED || Status::ERROR_OCCURRED) return;
 
-    Serial.print("[");
-    Serial.print(Status::as_string(Status::Value::OPEN));
-    Serial.print("]: ");
-    Serial.println(MQTTMessage["message"]);
+    LOG_INFO("[%s]: %s", Status::as_string(Status::Value::OPEN), (const char *) MQTTMessage["message"]);
+
+    Door::open();
+    Trace::mark(trace, Trace::ACTUATED);
+}
+
+void Status::handleTrace(__attribute__((unused)) const JSONVar &MQTTMessage) {
+    LOG_INFO("[%s requested]", Status::as_string(Status::Value::TRACE));
+
+    Trace::requestExport();
+}
+
+void Status::handleConfig(const JSONVar &MQTTMessage) {
+    Settings::Result result = Settings::Result::OK;
+    // a copy, the strings of the keys are freed with them at the end of the block
+    char failedKey[32] = "";
+
+    // the first bad key stops the batch, the keys before it stay staged
+    const JSONVar values = MQTTMessage["set"];
+    if (JSON.typeof(values) == "object") {
+        const JSONVar keys = values.keys();
+
+        for (int i = 0; i < keys.length() && result == Settings::Result::OK; ++i) {
+            const char *key = keys[i];
+
+            const String type = JSON.typeof(values[key]);
+            if (type == "string") {
+                result = Settings::set(key, values[key]);
+            } else if (type == "number") {
+                char number[12];
+                result = Settings::set(key, ltoa(long(values[key]), number, 10));
+            } else {
+                result = Settings::Result::BAD_VALUE;
+            }
+
+            if (result != Settings::Result::OK) snprintf(failedKey, sizeof(failedKey), "%s", key);
+        }
+    }
+
+    if (result == Settings::Result::OK && JSON.typeof(MQTTMessage["save"]) == "boolean" && bool(MQTTMessage["save"])) {
+        result = Settings::save();
+    }
+
+    LOG_INFO("[%s]: %s", Status::as_string(Status::Value::CONFIG), Settings::as_string(result));
+
+    JSONVar ack;
+    ack["status"]  = int(Status::Value::CONFIG);
+    ack["message"] = Status::as_string(Status::Value::CONFIG);
+    ack["ok"]      = result == Settings::Result::OK;
+    if (result != Settings::Result::OK) {
+        ack["error"] = Settings::as_string(result);
+        ack["key"]   = failedKey;
+    }
+    ack["saved"] = !Settings::dirty();
+
+    sendMessage(Outbound::INVENTORY, arduinoStreamTopic, ack);
+
+    if (result == Settings::Result::OK && JSON.typeof(MQTTMessage["reboot"]) == "boolean"
+        && bool(MQTTMessage["reboot"])) {
+        rebootTask.startDelayed();
+    }
+}
+
+void Status::handleSnapshot(__attribute__((unused)) const JSONVar &MQTTMessage) {
+    LOG_INFO("[%s requested]", Status::as_string(Status::Value::SNAPSHOT));
+
+    publishSnapshot(nullptr);
+}
+
+void Status::handleAuth(const JSONVar &MQTTMessage) {
+    // a full sync replaces the whole list, otherwise the message is a delta
+    if (JSON.typeof(MQTTMessage["clear"]) == "boolean" && bool(MQTTMessage["clear"])) AuthCache::clear();
+
+    const JSONVar allow = MQTTMessage["allow"];
+    if (JSON.typeof(allow) == "object") {
+        const JSONVar tags = allow.keys();
+
+        for (int i = 0; i < tags.length(); ++i) {
+            const char *tag = tags[i];
+            AuthCache::allow(strtoul(tag, nullptr, 16), JSON.typeof(allow[tag]) == "number" ? long(allow[tag]) : 0);
+        }
+    }
+
+    const JSONVar revoke = MQTTMessage["revoke"];
+    if (JSON.typeof(revoke) == "array") {
+        for (int i = 0; i < revoke.length(); ++i) {
+            if (JSON.typeof(revoke[i]) == "string") AuthCache::revoke(strtoul(revoke[i], nullptr, 16));
+        }
+    }
+
+    LOG_INFO("[%s]: %u tags", Status::as_string(Status::Value::AUTH), unsigned(AuthCache::stats().entries));
+}
+
+void Status::handleTags(const JSONVar &MQTTMessage) {
+    LOG_INFO("[%s]", Status::as_string(Status::Value::TAGS));
+
+    bool staged = true;
+
+    if (JSON.typeof(MQTTMessage["reset"]) == "boolean" && bool(MQTTMessage["reset"])) staged &= TagDirectory::reset();
+
+    const JSONVar add = MQTTMessage["add"];
+    for (int i = 0; JSON.typeof(add) == "array" && i < add.length(); ++i) {
+        if (JSON.typeof(add[i]) == "string") staged &= TagDirectory::add(strtoul(add[i], nullptr, 16));
+    }
+
+    const JSONVar remove = MQTTMessage["remove"];
+    for (int i = 0; JSON.typeof(remove) == "array" && i < remove.length(); ++i) {
+        if (JSON.typeof(remove[i]) == "string") staged &= TagDirectory::remove(strtoul(remove[i], nullptr, 16));
+    }
+
+    if (JSON.typeof(MQTTMessage["commit"]) == "number") staged &= TagDirectory::commit(long(MQTTMessage["commit"]));
 
-    openDoor(true);
+    // busy with the previous commit or the batch is too big: the server has to send it again
+    if (!staged) onTagDirectoryCommit(0, false);
 }
 
 void Status::handleConnect(const JSONVar &MQTTMessage) {
     Status::SERVER_CONNECTED = true;
 
-    Serial.println("[server connected]: ");
-    Serial.println(MQTTMessage["message"]);
+    LOG_INFO("[server connected]: %s", (const char *) MQTTMessage["message"]);
 }
 
 void Status::handleDisconnect(const JSONVar &MQTTMessage) {
     Status::SERVER_CONNECTED = false;
 
-    Serial.println("[server disconnected]: ");
-    Serial.println(MQTTMessage["message"]);
+    LOG_WARN("[server disconnected]: %s", (const char *) MQTTMessage["message"]);
 }
@@ -1,8 +1,6 @@
 #ifndef LETOVO_COMPUTERS_ARDUINO_MAIN_H
 #define LETOVO_COMPUTERS_ARDUINO_MAIN_H
 
-#include <set>
-#include <vector>
 #include <type_traits>
 #include <algorithm>
 
@@ -10,6 +8,8 @@
 #include <SoftTimer.h>
 
 #include "config.h"
+#include "door.h"
+#include "outbound.h"
 
 
 namespace Status {
@@ -24,7 +24,13 @@ namespace Status {
         CONNECT       = 4,
         OPEN          = 5,
         ERROR_OCCUR   = 7,
-        ERROR_RESOLVE = 8
+        ERROR_RESOLVE = 8,
+        SNAPSHOT      = 9,
+        AUTH          = 10,
+        TAGS          = 11,
+        TRACE         = 12,
+        DOOR          = 13,
+        CONFIG        = 14
     };
 
     const char *as_string(Value status) {
@@ -49,6 +55,24 @@ namespace Status {
             case Value::ERROR_RESOLVE:
                 // only for incoming messages
                 return "server error resolved";
+            case Value::SNAPSHOT:
+                // outgoing: current state, incoming: request for it
+                return "state snapshot";
+            case Value::AUTH:
+                // only for incoming messages
+                return "allow-list update";
+            case Value::TAGS:
+                // incoming: tag directory batch, outgoing: its acknowledgement
+                return "tag directory update";
+            case Value::TRACE:
+                // only for incoming messages
+                return "latency trace export";
+            case Value::DOOR:
+                // only for outgoing messages
+                return "door state changed";
+            case Value::CONFIG:
+                // incoming: settings update, outgoing: its acknowledgement
+                return "configuration update";
             default:
                 return "unknown status";
         }
@@ -63,22 +87,34 @@ namespace Status {
     void handleConnect(const JSONVar &MQTTMessage);
 
     void handleOpen(const JSONVar &MQTTMessage);
+
+    void handleSnapshot(const JSONVar &MQTTMessage);
+
+    void handleAuth(const JSONVar &MQTTMessage);
+
+    void handleTags(const JSONVar &MQTTMessage);
+
+    void handleTrace(const JSONVar &MQTTMessage);
+
+    void handleConfig(const JSONVar &MQTTMessage);
 }
 
-namespace SetSubtract {
-    auto operator-(const std::set<const char *> &_first, const std::set<const char *> &_last)
-    -> std::vector<const char *> {
-        std::vector<const char *> _res;
-        std::set_difference(
-                _first.begin(), _first.end(),
-                _last.begin(), _last.end(),
-                std::inserter(_res, _res.begin())
-        );
-
-        return _res;
-    }
+namespace Snapshot {
+    // bit (row * COLS + col) is set if the slot is occupied
+    static uint32_t slots = 0;
+
+    enum StateFlag : uint8_t {
+        SERVER_CONNECTED = 1 << 0,
+        ERROR_OCCURRED   = 1 << 1,
+        DOOR_OPEN        = 1 << 2,
+    };
+
+    static_assert(ROWS * COLS <= 32, "slot bitmap does not fit into uint32_t");
 }
 
+// a PLACE/TAKE slot list of all slots with ids of up to 7 characters
+static const size_t SLOT_LIST_MAX = ROWS * COLS * 8 + 1;
+
 #if USE_UNSAFE_POINTER_CAST
 // check if _field is a member of _struct and return its name as a string if it is
 #define verifyField(_field, _struct) ((_struct){}._field, #_field)
@@ -98,47 +134,34 @@ const char *memberNames[] = {
 };
 #endif
 
-class RepeatedString : public Printable {
-public:
-    RepeatedString(const char *str, unsigned int count)
-            : _str(str), _count(count) {}
-
-    virtual ~RepeatedString() = default;
-
-    size_t printTo(Print &p) const override {
-        size_t sz = 0;
-
-        for (unsigned int i = 0; i < _count; ++i)
-            sz += p.print(_str);
-
-        return sz;
-    }
-
-private:
-    const char   *_str;
-    unsigned int _count;
-};
+static char latestRFID[20] = "null";
 
 JSONVar createMessage(Status::Value status, const char *slots = "", const char *tag = latestRFID);
 
-int sendMessage(const char *topic, const JSONVar &message);
-
-int sendWillMessage(const JSONVar &message);
+JSONVar createSnapshot();
 
-bool connectToBroker();
+bool sendMessage(Outbound::Class cls, const char *topic, const JSONVar &message, bool merge = false,
+                 uint16_t trace = 0, Outbound::Sequence sequence = Outbound::UNSEQUENCED);
 
-void connectToInternet();
+void onMessageDropped(Outbound::Class cls);
 
-void openDoor(bool isOpen);
+void onTagDirectoryCommit(uint32_t version, bool ok);
 
-void checkWiFiConnection(Task *me);
+void onDoorChange(Door::State state);
 
-void checkBrokerConnection(Task *me);
+void onConnectionReady();
 
 void listenForRFID(Task *me);
 
+// the ids of the slots set in the bitmap, each followed by ';', the ones that do not fit into size are left out
+void slotList(uint32_t slots, char *text, size_t size);
+
 void listenForButtons(Task *me);
 
 void MQTTPoll(__attribute__((unused)) Task *me);
 
+void publishSnapshot(Task *me);
+
+boolean reboot(Task *me);
+
 #endif //LETOVO_COMPUTERS_ARDUINO_MAIN_H
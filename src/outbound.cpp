@@ -0,0 +1,361 @@
+#include "outbound.h"
+#include "connection.h"
+#include "config.h"
+#include "boot.h"
+#include "flight_recorder.h"
+#include "log.h"
+#include "trace.h"
+
+namespace Outbound {
+    struct Policy {
+        uint8_t  qos;
+        // token bucket: sustained rate and the burst allowed on top of it
+        uint16_t messagesPerMinute;
+        uint8_t  burst;
+    };
+
+    struct Message {
+        const char *topic;
+        // packet id of the latest attempt, 0 if it never made it to the wire
+        uint16_t   packetId;
+        uint8_t    attempts;
+        bool       retain;
+        // millis() at enqueue
+        uint32_t   enqueuedAt;
+        uint16_t   trace;
+        uint16_t   length;
+        Sequence   sequence;
+        // the sequence members are in the payload, a retry must not number it again
+        bool       stamped;
+        // seq stamped on a snapshot
+        uint32_t   stamp;
+        char       payload[OUTBOUND_PAYLOAD_MAX];
+    };
+
+    struct Sequences {
+        // seq of the latest acknowledged snapshot, 0 if none was acknowledged yet
+        uint32_t snapshot;
+        // deltas stamped since that snapshot
+        uint32_t delta;
+    };
+
+    struct Queue {
+        Message *slots;
+        uint8_t capacity;
+        uint8_t head;
+        uint8_t count;
+        // tokens in 1/60000 of a message, refilled every ms by messagesPerMinute
+        uint32_t tokens;
+
+        Message &at(uint8_t i) { return slots[(head + i) % capacity]; }
+    };
+
+    // QoS 1 for SCAN: one round trip less than QoS 2, and a duplicate SCAN only makes the server answer twice.
+    // Deltas keep QoS 2, a duplicate would be detected by its sequence number anyway. Telemetry is fire and forget.
+    static const Policy POLICIES[CLASSES] = {
+            {1, 600, 5},
+            {2, 600, 10},
+            {0, 60,  2},
+    };
+
+    static const uint32_t TOKEN = 60000;
+
+    static Message interactiveSlots[OUTBOUND_INTERACTIVE_QUEUE];
+    static Message inventorySlots[OUTBOUND_INVENTORY_QUEUE];
+    static Message telemetrySlots[OUTBOUND_TELEMETRY_QUEUE];
+
+    static Queue queues[CLASSES] = {
+            {interactiveSlots, OUTBOUND_INTERACTIVE_QUEUE, 0, 0, 0},
+            {inventorySlots,   OUTBOUND_INVENTORY_QUEUE,   0, 0, 0},
+            {telemetrySlots,   OUTBOUND_TELEMETRY_QUEUE,   0, 0, 0},
+    };
+
+    static Stats stats_[CLASSES] = {};
+
+    static Sequences sequences[CLASSES] = {};
+    // tells the numbers of this boot from the ones of the previous boots, they start over at every boot
+    static uint16_t  epoch              = 0;
+
+    static MqttClient    *mqttClient = nullptr;
+    static MqttTransport *transport  = nullptr;
+
+    static void (*onDrop)(Class cls) = nullptr;
+
+    static unsigned long refilledAt = 0;
+
+    // class whose head is being published, CLASSES if none. endMessage() polls the client while it waits for the
+    // ack, the message handlers it runs may enqueue, and that must neither merge nor drop the message on the wire.
+    static uint8_t publishing = CLASSES;
+
+    static_assert(OUTBOUND_INTERACTIVE_QUEUE >= 2 && OUTBOUND_INVENTORY_QUEUE >= 2 && OUTBOUND_TELEMETRY_QUEUE >= 2,
+                  "a full queue needs a slot besides the one being published");
+
+    static void remove(Class cls, uint8_t index) {
+        Queue &queue = queues[cls];
+
+        // shift the younger messages one slot towards the head to keep the order
+        for (uint8_t i = index; i + 1 < queue.count; ++i) {
+            queue.at(i) = queue.at(i + 1);
+        }
+        --queue.count;
+        stats_[cls].depth = queue.count;
+    }
+
+    static void pop(Class cls) {
+        Queue &queue = queues[cls];
+
+        uint8_t bucket = 0;
+        for (uint32_t latency = millis() - queue.at(0).enqueuedAt; latency; latency >>= 1) ++bucket;
+
+        uint16_t &count = stats_[cls].latency[min<uint8_t>(bucket, OUTBOUND_LATENCY_BUCKETS - 1)];
+        if (count < UINT16_MAX) ++count;
+
+        const Message &message = queue.at(0);
+        if (message.sequence == SNAPSHOT && message.stamped) {
+            sequences[cls].snapshot = message.stamp;
+            sequences[cls].delta    = 0;
+        }
+
+        ++stats_[cls].sent;
+        Boot::mark(Boot::PUBLISHED);
+        FlightRecorder::record(FlightRecorder::PUBLISH, cls);
+        queue.head = (queue.head + 1) % queue.capacity;
+        --queue.count;
+        stats_[cls].depth = queue.count;
+    }
+
+    // onDrop is not called from here, it may enqueue again and has to wait until the queue is consistent
+    static void drop(Class cls, uint8_t index) {
+        // a stamped snapshot may have reached the broker, its seq is not given to another one
+        const Message &message = queues[cls].at(index);
+        if (message.sequence == SNAPSHOT && message.stamped) {
+            sequences[cls].snapshot = message.stamp;
+            sequences[cls].delta    = 0;
+        }
+
+        transport->forget(message.packetId);
+        remove(cls, index);
+        ++stats_[cls].dropped;
+        FlightRecorder::record(FlightRecorder::DROP, cls);
+    }
+
+    static void refill() {
+        const unsigned long now     = millis();
+        const unsigned long elapsed = now - refilledAt;
+        refilledAt = now;
+
+        for (uint8_t cls = 0; cls < CLASSES; ++cls) {
+            const uint32_t limit = uint32_t(POLICIES[cls].burst) * TOKEN;
+
+            queues[cls].tokens = min<uint32_t>(limit, queues[cls].tokens + elapsed * POLICIES[cls].messagesPerMinute);
+        }
+    }
+
+    static void stamp(Class cls, Message &message) {
+        if (message.sequence == UNSEQUENCED || message.stamped) return;
+
+        char members[OUTBOUND_STAMP_MAX + 1];
+        if (message.sequence == SNAPSHOT) {
+            message.stamp = sequences[cls].snapshot + 1;
+            snprintf(members, sizeof(members), ",\"epoch\":%u,\"seq\":%lu}", unsigned(epoch),
+                     (unsigned long) message.stamp);
+        } else {
+            snprintf(members, sizeof(members), ",\"epoch\":%u,\"snapshot\":%lu,\"delta\":%lu}", unsigned(epoch),
+                     (unsigned long) sequences[cls].snapshot, (unsigned long) ++sequences[cls].delta);
+        }
+
+        // the members replace the closing brace of the object, an empty object gets no leading comma
+        const char *appended = message.length == 2 ? members + 1 : members;
+        const size_t length  = strlen(appended);
+        memcpy(message.payload + message.length - 1, appended, length);
+        message.length += length - 1;
+        message.stamped = true;
+    }
+
+    // a message that went on the wire keeps its packet id, the broker would take a new one for another message
+    static bool republish(Message &message, uint8_t qos) {
+        if (!transport->republish(message.topic, reinterpret_cast<const uint8_t *>(message.payload), message.length,
+                                  message.retain, qos, message.packetId)) {
+            return false;
+        }
+        Trace::mark(message.trace, Trace::PUBLISH_END);
+
+        // as long as endMessage() waits for an acknowledgement
+        for (const unsigned long start = millis();
+             millis() - start < MQTT_ACK_TIMEOUT_MS && mqttClient->connected();) {
+            mqttClient->poll();
+
+            if (!transport->isInflight(message.packetId)) {
+                Trace::mark(message.trace, Trace::ACKED);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool publish(Message &message, uint8_t qos) {
+        if (message.packetId) return republish(message, qos);
+
+        if (!mqttClient->beginMessage(message.topic, message.length, message.retain, qos, false)) {
+            return false;
+        }
+
+        const uint16_t lastPublishId = transport->lastPublishId();
+
+        mqttClient->write(reinterpret_cast<const uint8_t *>(message.payload), message.length);
+        Trace::mark(message.trace, Trace::PUBLISH_END);
+
+        // waits for the acknowledgement at QoS 1/2
+        if (mqttClient->endMessage()) {
+            Trace::mark(message.trace, Trace::ACKED);
+            return true;
+        }
+
+        message.packetId = transport->lastPublishId() != lastPublishId ? transport->lastPublishId() : 0;
+        return false;
+    }
+}
+
+void Outbound::begin(MqttClient &client, MqttTransport &clientTransport, void (*dropCallback)(Class cls),
+                     uint16_t bootEpoch) {
+    mqttClient = &client;
+    transport  = &clientTransport;
+    onDrop     = dropCallback;
+    epoch      = bootEpoch;
+
+    refilledAt = millis();
+    for (uint8_t cls = 0; cls < CLASSES; ++cls) {
+        queues[cls].tokens = uint32_t(POLICIES[cls].burst) * TOKEN;
+    }
+}
+
+bool Outbound::enqueue(Class cls, const char *topic, const char *payload, bool retain, bool merge, uint16_t trace,
+                       Sequence sequence) {
+    Queue &queue = queues[cls];
+
+    const size_t length = strlen(payload);
+    const bool   object = length >= 2 && payload[length - 1] == '}';
+    if (length + (sequence != UNSEQUENCED ? OUTBOUND_STAMP_MAX : 0) > OUTBOUND_PAYLOAD_MAX
+        || (sequence != UNSEQUENCED && !object)) {
+        LOG_ERROR("## Message to %s is too long or not sequenceable, dropped", topic);
+
+        ++stats_[cls].dropped;
+        FlightRecorder::record(FlightRecorder::DROP, cls);
+        return false;
+    }
+
+    // the head being published stays where it is
+    const uint8_t first = cls == publishing ? 1 : 0;
+
+    if (merge) {
+        // the newer message supersedes the queued one, it goes to the tail to keep the order of the deltas
+        for (uint8_t i = first; i < queue.count; ++i) {
+            // a stamped message may have reached the broker already, its numbers are spent
+            if (queue.at(i).topic != topic || queue.at(i).stamped) continue;
+
+            transport->forget(queue.at(i).packetId);
+            remove(cls, i);
+            ++stats_[cls].merged;
+            break;
+        }
+    }
+
+    const bool full = queue.count == queue.capacity;
+    if (full) {
+        // the newest message is the most relevant one
+        LOG_WARN("## Outbound queue %u is full, dropping the oldest message", unsigned(cls));
+
+        drop(cls, first);
+    }
+
+    Message &message = queue.at(queue.count);
+    message.topic      = topic;
+    message.packetId   = 0;
+    message.attempts   = 0;
+    message.retain     = retain;
+    message.enqueuedAt = millis();
+    message.trace      = trace;
+    message.length     = length;
+    message.sequence   = sequence;
+    message.stamped    = false;
+    message.stamp      = 0;
+    memcpy(message.payload, payload, length);
+
+    ++queue.count;
+
+    Stats &stats = stats_[cls];
+    ++stats.enqueued;
+    stats.depth     = queue.count;
+    stats.peakDepth = max(stats.peakDepth, stats.depth);
+
+    if (full && onDrop) onDrop(cls);
+
+    return true;
+}
+
+void Outbound::step(__attribute__((unused)) Task *me) {
+    refill();
+
+    // everything stays queued while offline and goes out in priority order after the reconnect
+    if (!Connection::ready()) return;
+
+    for (uint8_t cls = 0; cls < CLASSES; ++cls) {
+        Queue &queue = queues[cls];
+        if (!queue.count) continue;
+        // a rate limited class does not block the classes below it
+        if (queue.tokens < TOKEN) continue;
+
+        queue.tokens -= TOKEN;
+
+        Message &message = queue.at(0);
+
+        // acknowledged after endMessage() gave up waiting
+        if (message.packetId && !transport->isInflight(message.packetId)) {
+            Trace::mark(message.trace, Trace::ACKED);
+            pop(Class(cls));
+            return;
+        }
+
+        Trace::mark(message.trace, Trace::PUBLISH_BEGIN);
+        stamp(Class(cls), message);
+        publishing = cls;
+        const bool published = publish(message, POLICIES[cls].qos);
+        publishing = CLASSES;
+
+        if (published) {
+            pop(Class(cls));
+            return;
+        }
+
+        // a failure while the connection looks fine means the broker or the message is the problem
+        if (++message.attempts >= OUTBOUND_ATTEMPTS_MAX && mqttClient->connected()) {
+            LOG_WARN("## Giving up on a message to %s", message.topic);
+
+            drop(Class(cls), 0);
+            if (onDrop) onDrop(Class(cls));
+        }
+        return;
+    }
+}
+
+const Outbound::Stats &Outbound::stats(Class cls) { return stats_[cls]; }
+
+uint32_t Outbound::latencyPercentile(Class cls, uint8_t percent) {
+    const uint16_t *latency = stats_[cls].latency;
+
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < OUTBOUND_LATENCY_BUCKETS; ++i) total += latency[i];
+    if (!total) return 0;
+
+    // the first bucket that brings the running count to the percentile
+    uint32_t count = 0;
+    for (uint8_t i = 0; i < OUTBOUND_LATENCY_BUCKETS; ++i) {
+        count += latency[i];
+        if (count * 100 >= total * percent) return 1UL << i;
+    }
+    return 1UL << (OUTBOUND_LATENCY_BUCKETS - 1);
+}
+
+void Outbound::resetLatency(Class cls) {
+    memset(stats_[cls].latency, 0, sizeof(stats_[cls].latency));
+}
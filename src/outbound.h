@@ -0,0 +1,70 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_OUTBOUND_H
+#define LETOVO_COMPUTERS_ARDUINO_OUTBOUND_H
+
+#include <ArduinoMqttClient.h>
+#include <SoftTimer.h>
+
+#include "transport.h"
+
+// max length of a serialized outgoing message
+#define OUTBOUND_PAYLOAD_MAX 320
+// room left in the payload for the members stamped on a sequenced message
+#define OUTBOUND_STAMP_MAX 64
+// bucket i of the latency histogram counts messages sent within [2^(i-1), 2^i) ms after they were enqueued
+#define OUTBOUND_LATENCY_BUCKETS 16
+
+// Outgoing message scheduler. Messages are queued per priority class, and step() publishes at most one message per
+// call, always from the most important class that has something queued and a token left in its rate limiter.
+// A burst of slot changes therefore cannot hold back the SCAN the server has to answer with OPEN.
+namespace Outbound {
+    enum Class : uint8_t {
+        INTERACTIVE = 0,  // SCAN: the user is waiting at the door
+        INVENTORY   = 1,  // PLACE/TAKE deltas and snapshots
+        TELEMETRY   = 2,  // device health, best effort
+        CLASSES     = 3,
+    };
+
+    // Sequence numbers are stamped on a message when it goes on the wire for the first time, so they follow the
+    // order in which the broker sees the messages of a class, whatever was merged or dropped while they were queued.
+    enum Sequence : uint8_t {
+        UNSEQUENCED = 0,
+        // gets "epoch", "snapshot" (seq of the latest acknowledged or dropped snapshot of the class) and "delta"
+        // (its number since then)
+        DELTA       = 1,
+        // gets "epoch" and "seq", the deltas are numbered from it once it is acknowledged or dropped
+        SNAPSHOT    = 2,
+    };
+
+    struct Stats {
+        uint16_t enqueued;
+        uint16_t sent;
+        // replaced by a newer message to the same topic
+        uint16_t merged;
+        // pushed out of a full queue, too long, or failed too many times
+        uint16_t dropped;
+        uint8_t  depth;
+        uint8_t  peakDepth;
+        uint16_t latency[OUTBOUND_LATENCY_BUCKETS];
+    };
+
+    // onDrop is called after a message of the class was dropped, e.g. to schedule a resync; epoch is stamped on the
+    // sequenced messages to tell the boots apart
+    void begin(MqttClient &client, MqttTransport &transport, void (*onDrop)(Class cls), uint16_t epoch);
+
+    // merge - replace a queued message of the same class and topic instead of queueing another one
+    // trace - id of the latency trace the publish stages are stamped on, 0 for none
+    // sequence - members to stamp on a payload that is a JSON object, the numbers are kept per class
+    bool enqueue(Class cls, const char *topic, const char *payload, bool retain, bool merge = false,
+                 uint16_t trace = 0, Sequence sequence = UNSEQUENCED);
+
+    void step(Task *me);
+
+    const Stats &stats(Class cls);
+
+    // upper bound in ms of the latency below which the given percent of the sent messages stayed, 0 if none was sent
+    uint32_t latencyPercentile(Class cls, uint8_t percent);
+
+    void resetLatency(Class cls);
+}
+
+#endif //LETOVO_COMPUTERS_ARDUINO_OUTBOUND_H
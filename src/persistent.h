@@ -0,0 +1,28 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_PERSISTENT_H
+#define LETOVO_COMPUTERS_ARDUINO_PERSISTENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Variables in this section are neither zeroed nor initialized by the startup code, so they keep their content
+// over a warm reset (NVIC_SystemReset(), watchdog, hard fault). After a power cut they hold garbage, so guard them
+// with a magic number and a CRC. The section flags are spelled out as GCC would emit .noinit as PROGBITS;
+// '@' comments out the rest of the directive in the ARM assembler. linker/noinit.ld places the section between .bss
+// and the heap.
+#define NOINIT __attribute__((section(".noinit,\"aw\",%nobits@")))
+
+// CRC-32 (IEEE 802.3), bitwise: the structures it guards are small and checked once per boot
+inline uint32_t crc32(const void *data, size_t size, uint32_t crc = 0) {
+    auto bytes = static_cast<const uint8_t *>(data);
+
+    crc = ~crc;
+    while (size--) {
+        crc ^= *bytes++;
+        for (uint8_t bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xEDB88320UL & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+#endif //LETOVO_COMPUTERS_ARDUINO_PERSISTENT_H
@@ -0,0 +1,57 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_POOL_H
+#define LETOVO_COMPUTERS_ARDUINO_POOL_H
+
+#include <Arduino.h>
+
+// COUNT blocks of BLOCK bytes in a static array. The free blocks are linked through their first word, so allocation
+// and release take constant time, and a released block fits any later request of the pool: it cannot fragment.
+// All members are zero-initialized, the pool is usable before the constructors of the globals have run.
+template<size_t BLOCK, uint16_t COUNT>
+class Pool {
+    static_assert(BLOCK >= sizeof(void *) && BLOCK % 8 == 0, "a block must hold a pointer and keep the alignment");
+
+public:
+    static const size_t BLOCK_BYTES = BLOCK;
+
+    // nullptr if all blocks are in use
+    void *allocate() {
+        void *block;
+
+        if (freeList) {
+            block    = freeList;
+            freeList = *static_cast<void **>(block);
+        } else if (fresh < COUNT) {
+            block = storage[fresh++];
+        } else {
+            return nullptr;
+        }
+
+        if (++used_ > peak_) peak_ = used_;
+        return block;
+    }
+
+    void release(void *block) {
+        *static_cast<void **>(block) = freeList;
+        freeList = block;
+        --used_;
+    }
+
+    bool owns(const void *pointer) const {
+        const auto *byte = static_cast<const uint8_t *>(pointer);
+        return byte >= storage[0] && byte < reinterpret_cast<const uint8_t *>(storage + COUNT);
+    }
+
+    uint16_t used() const { return used_; }
+
+    uint16_t peak() const { return peak_; }
+
+private:
+    alignas(8) uint8_t storage[COUNT][BLOCK];
+    void     *freeList;
+    // blocks that were never handed out start at this index
+    uint16_t fresh;
+    uint16_t used_;
+    uint16_t peak_;
+};
+
+#endif //LETOVO_COMPUTERS_ARDUINO_POOL_H
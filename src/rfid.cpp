@@ -0,0 +1,155 @@
+#include "rfid.h"
+#include "config.h"
+
+namespace Rfid {
+    // STX, 10 hex digits of data (version byte and 4 bytes of tag id), 2 hex digits of checksum, ETX
+    static const uint8_t FRAME_START  = 0x02;
+    static const uint8_t FRAME_END    = 0x03;
+    static const uint8_t FRAME_LENGTH = 14;
+
+    struct Reader {
+        HardwareSerial    *serial;
+        uint8_t           frame[FRAME_LENGTH];
+        uint8_t           received;
+        // the latest tag and when it was seen, each reader has its own, so one tag can be scanned at two doors
+        volatile uint32_t tag;
+        volatile uint32_t seenAt;
+        Stats             stats;
+    };
+
+    struct Event {
+        uint8_t  reader;
+        uint32_t tag;
+        uint32_t capturedAt;
+    };
+
+    static Reader           readers_[RFID_READERS_MAX] = {};
+    static volatile uint8_t readersCount               = 0;
+
+    // single producer (interrupt), single consumer (task) queue shared by all readers
+    static Event            events[RFID_EVENTS_MAX];
+    static volatile uint8_t eventsHead = 0;
+    static volatile uint8_t eventsTail = 0;
+
+    static int8_t hexDigit(uint8_t c) {
+        if (c >= '0' && c <= '9') return int8_t(c - '0');
+        if (c >= 'A' && c <= 'F') return int8_t(c - 'A' + 10);
+        if (c >= 'a' && c <= 'f') return int8_t(c - 'a' + 10);
+        return -1;
+    }
+
+    // decodes the 5 data bytes and the checksum, returns false if the frame is malformed
+    static bool decode(const uint8_t *frame, uint32_t &tag) {
+        if (frame[FRAME_LENGTH - 1] != FRAME_END) return false;
+
+        uint8_t bytes[6];
+        for (uint8_t i = 0; i < 6; ++i) {
+            const int8_t high = hexDigit(frame[1 + 2 * i]);
+            const int8_t low  = hexDigit(frame[2 + 2 * i]);
+            if (high < 0 || low < 0) return false;
+
+            bytes[i] = uint8_t(high << 4 | low);
+        }
+
+        if ((bytes[0] ^ bytes[1] ^ bytes[2] ^ bytes[3] ^ bytes[4]) != bytes[5]) return false;
+
+        // the version byte is dropped, as the rdm6300 library did
+        tag = uint32_t(bytes[1]) << 24 | uint32_t(bytes[2]) << 16 | uint32_t(bytes[3]) << 8 | bytes[4];
+        return true;
+    }
+
+    static bool post(uint8_t reader, uint32_t tag) {
+        const uint8_t next = (eventsHead + 1) % RFID_EVENTS_MAX;
+        if (next == eventsTail) return false;
+
+        // the hook runs before the core counts the new tick, so micros() is a millisecond behind in here
+        events[eventsHead] = {reader, tag, micros() + 1000};
+        eventsHead = next;
+        return true;
+    }
+
+    static void onFrame(uint8_t index) {
+        Reader &reader = readers_[index];
+
+        uint32_t tag;
+        if (!decode(reader.frame, tag)) {
+            ++reader.stats.badFrames;
+            return;
+        }
+        ++reader.stats.frames;
+
+        // the reader repeats the frame while the tag stays in the field, only the first one is an event
+        const uint32_t now = millis();
+        if ((tag != reader.tag || now - reader.seenAt > RFID_TAG_TIMEOUT_MS) && !post(index, tag)) {
+            ++reader.stats.droppedEvents;
+        }
+
+        reader.tag    = tag;
+        reader.seenAt = now;
+    }
+
+    static void service(uint8_t index) {
+        Reader &reader = readers_[index];
+
+        while (reader.serial->available()) {
+            const uint8_t c = reader.serial->read();
+
+            // a start byte always begins a new frame, so a lost byte costs one frame at most
+            if (c == FRAME_START) reader.received = 0;
+            else if (!reader.received) continue;
+
+            reader.frame[reader.received++] = c;
+            if (reader.received == FRAME_LENGTH) {
+                onFrame(index);
+                reader.received = 0;
+            }
+        }
+    }
+}
+
+void Rfid::tick() {
+    for (uint8_t i = 0; i < readersCount; ++i) service(i);
+}
+
+void Rfid::begin(HardwareSerial *const *serials, uint8_t count) {
+    count = min<uint8_t>(count, RFID_READERS_MAX);
+
+    for (uint8_t i = 0; i < count; ++i) {
+        serials[i]->begin(RDM6300_BAUD_RATE);
+        readers_[i].serial = serials[i];
+    }
+
+    // the readers are serviced from the interrupt once they are counted
+    readersCount = count;
+}
+
+uint8_t Rfid::readers() { return readersCount; }
+
+bool Rfid::nextTag(uint8_t &reader, uint32_t &tag, uint32_t &capturedAt) {
+    if (eventsTail == eventsHead) return false;
+
+    reader     = events[eventsTail].reader;
+    tag        = events[eventsTail].tag;
+    capturedAt = events[eventsTail].capturedAt;
+    eventsTail = (eventsTail + 1) % RFID_EVENTS_MAX;
+    return true;
+}
+
+uint32_t Rfid::currentTag(uint8_t reader) {
+    if (reader >= readersCount) return 0;
+
+    const uint32_t tag = readers_[reader].tag;
+    return millis() - readers_[reader].seenAt <= RFID_TAG_TIMEOUT_MS ? tag : 0;
+}
+
+const Rfid::Stats &Rfid::stats(uint8_t reader) {
+    static const Stats none = {};
+    return reader < readersCount ? readers_[reader].stats : none;
+}
+
+bool Rfid::idle() {
+    for (uint8_t i = 0; i < readersCount; ++i) {
+        if (readers_[i].received || currentTag(i)) return false;
+    }
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_RFID_H
+#define LETOVO_COMPUTERS_ARDUINO_RFID_H
+
+#include <Arduino.h>
+
+// max number of RDM6300 readers, each on its own UART
+#define RFID_READERS_MAX 4
+// number of tag events buffered between the interrupt and the task
+#define RFID_EVENTS_MAX 8
+
+// RDM6300 reception in the background. The core's SERCOM interrupts fill the UART ring buffers, and the SysTick hook
+// drains them every millisecond, frames and checksums the 14-byte packets and posts a tag event for every new tag.
+// A task that blocks for seconds therefore neither overflows the UART buffers nor loses a scan.
+namespace Rfid {
+    struct Stats {
+        uint16_t frames;
+        // frames with a wrong checksum, a non-hex digit or a missing end byte
+        uint16_t badFrames;
+        // tag events lost because the task did not fetch them in time
+        uint16_t droppedEvents;
+    };
+
+    // serials[i] is the UART of reader i
+    void begin(HardwareSerial *const *serials, uint8_t count);
+
+    uint8_t readers();
+
+    // fetches the oldest new tag of any reader, returns false if there is none
+    // capturedAt - micros() when its frame was complete
+    bool nextTag(uint8_t &reader, uint32_t &tag, uint32_t &capturedAt);
+
+    // the tag in front of the reader, 0 if none
+    uint32_t currentTag(uint8_t reader);
+
+    const Stats &stats(uint8_t reader);
+
+    // no frame is being received and no tag is in front of a reader, e.g. for a flash erase that stalls the interrupts
+    bool idle();
+
+    // called from the SysTick interrupt every millisecond
+    void tick();
+}
+
+#endif //LETOVO_COMPUTERS_ARDUINO_RFID_H
@@ -0,0 +1,277 @@
+#include "settings.h"
+
+#include "config.h"
+#include "flash.h"
+#include "log.h"
+#include "persistent.h"
+
+namespace Settings {
+    struct Values {
+        char     wifiSsid[33];
+        char     wifiPass[SETTINGS_TEXT_MAX];
+        char     mqttHost[SETTINGS_TEXT_MAX];
+        char     mqttUser[32];
+        char     mqttPass[SETTINGS_TEXT_MAX];
+        char     mqttClientId[32];
+        char     arduinoStreamTopic[SETTINGS_TEXT_MAX];
+        char     arduinoWillTopic[SETTINGS_TEXT_MAX];
+        char     serverStreamTopic[SETTINGS_TEXT_MAX];
+        char     serverWillTopic[SETTINGS_TEXT_MAX];
+        char     arduinoSnapshotTopic[SETTINGS_TEXT_MAX];
+        char     arduinoTelemetryTopic[SETTINGS_TEXT_MAX];
+        char     arduinoTraceTopic[SETTINGS_TEXT_MAX];
+        uint16_t mqttPort;
+    };
+
+    static const uint32_t MAGIC  = 0x464e4f43;  // "CONF"
+    // bumped with every change of Values, a record of another layout is ignored
+    static const uint16_t LAYOUT = 1;
+    static const uint8_t  SLOTS  = 2;
+    static const uint8_t  NO_SLOT = SLOTS;
+
+    struct Record {
+        uint32_t magic;
+        uint16_t layout;
+        uint16_t size;
+        // the slot with the higher sequence is the newer one
+        uint32_t sequence;
+        Values   values;
+        uint32_t crc;
+    };
+
+    static const uint32_t SLOT_BYTES = (sizeof(Record) + Flash::ROW_BYTES - 1) / Flash::ROW_BYTES * Flash::ROW_BYTES;
+
+    struct Slot {
+        Record  record;
+        uint8_t padding[SLOT_BYTES - sizeof(Record)];
+    };
+
+    // zero-filled by the upload, i.e. two invalid slots
+    __attribute__((aligned(Flash::ROW_BYTES))) static const Slot storage[SLOTS] = {};
+
+    // a literal that does not fit is a compile error
+    static const Values DEFAULTS = {
+            WIFI_SSID, WIFI_PASS, MQTT_HOST, MQTT_USER, MQTT_PASS, MQTT_CLIENT_ID,
+            ARDUINO_STREAM_TOPIC, ARDUINO_WILL_TOPIC, SERVER_STREAM_TOPIC, SERVER_WILL_TOPIC,
+            ARDUINO_SNAPSHOT_TOPIC, ARDUINO_TELEMETRY_TOPIC, ARDUINO_TRACE_TOPIC,
+            MQTT_PORT,
+    };
+
+    enum Kind : uint8_t {
+        TEXT = 0,
+        PORT = 1,
+    };
+
+    struct Field {
+        const char *key;
+        Kind       kind;
+        bool       secret;
+        uint16_t   offset;
+        uint8_t    size;
+        // the global of config.h that is pointed into the loaded values
+        const char **text;
+    };
+
+#define SETTINGS_TEXT(_key, _member, _secret, _global) \
+    {_key, TEXT, _secret, offsetof(Values, _member), sizeof(Values::_member), &(_global)}
+
+    static const Field FIELDS[] = {
+            SETTINGS_TEXT("WIFI_SSID", wifiSsid, false, wifiSSID),
+            SETTINGS_TEXT("WIFI_PASS", wifiPass, true, wifiPass),
+            SETTINGS_TEXT("MQTT_HOST", mqttHost, false, brokerHost),
+            {"MQTT_PORT", PORT, false, offsetof(Values, mqttPort), sizeof(Values::mqttPort), nullptr},
+            SETTINGS_TEXT("MQTT_USER", mqttUser, false, brokerUser),
+            SETTINGS_TEXT("MQTT_PASS", mqttPass, true, brokerPass),
+            SETTINGS_TEXT("MQTT_CLIENT_ID", mqttClientId, false, clientID),
+            SETTINGS_TEXT("ARDUINO_STREAM_TOPIC", arduinoStreamTopic, false, arduinoStreamTopic),
+            SETTINGS_TEXT("ARDUINO_WILL_TOPIC", arduinoWillTopic, false, arduinoWillTopic),
+            SETTINGS_TEXT("SERVER_STREAM_TOPIC", serverStreamTopic, false, serverStreamTopic),
+            SETTINGS_TEXT("SERVER_WILL_TOPIC", serverWillTopic, false, serverWillTopic),
+            SETTINGS_TEXT("ARDUINO_SNAPSHOT_TOPIC", arduinoSnapshotTopic, false, arduinoSnapshotTopic),
+            SETTINGS_TEXT("ARDUINO_TELEMETRY_TOPIC", arduinoTelemetryTopic, false, arduinoTelemetryTopic),
+            SETTINGS_TEXT("ARDUINO_TRACE_TOPIC", arduinoTraceTopic, false, arduinoTraceTopic),
+    };
+
+#undef SETTINGS_TEXT
+
+    static const uint8_t FIELDS_COUNT = sizeof(FIELDS) / sizeof(FIELDS[0]);
+
+    // slot the globals point into since begin(), it is not written before the next reset
+    static uint8_t  loaded   = NO_SLOT;
+    static uint32_t sequence = 0;
+
+    // the record being edited, written to flash as it is
+    static Record staged;
+    static bool   dirty_ = false;
+
+    // the compiler must not assume the zeros of the initializer, the content is written at run time
+    static const Record *record(uint8_t index) {
+        const Slot *pointer = &storage[index];
+        asm volatile("" : "+r"(pointer));
+        return &pointer->record;
+    }
+
+    static uint32_t recordCrc(const Record &record) {
+        return crc32(&record, offsetof(Record, crc));
+    }
+
+    static bool valid(uint8_t index) {
+        const Record &candidate = *record(index);
+
+        return candidate.magic == MAGIC && candidate.layout == LAYOUT && candidate.size == sizeof(Values)
+               && candidate.crc == recordCrc(candidate);
+    }
+
+    static char *text(Values &values, const Field &field) {
+        return reinterpret_cast<char *>(&values) + field.offset;
+    }
+
+    static const Field *find(const char *key) {
+        for (const Field &field: FIELDS) {
+            if (!strcmp(field.key, key)) return &field;
+        }
+        return nullptr;
+    }
+
+    static void apply(const Values &values) {
+        for (const Field &field: FIELDS) {
+            if (field.text) *field.text = text(const_cast<Values &>(values), field);
+        }
+        brokerPort = values.mqttPort;
+    }
+}
+
+const char *brokerHost = Settings::DEFAULTS.mqttHost;
+uint16_t   brokerPort  = Settings::DEFAULTS.mqttPort;
+const char *brokerUser = Settings::DEFAULTS.mqttUser;
+const char *brokerPass = Settings::DEFAULTS.mqttPass;
+const char *clientID   = Settings::DEFAULTS.mqttClientId;
+
+const char *wifiSSID = Settings::DEFAULTS.wifiSsid;
+const char *wifiPass = Settings::DEFAULTS.wifiPass;
+
+const char *arduinoStreamTopic    = Settings::DEFAULTS.arduinoStreamTopic;
+const char *arduinoWillTopic      = Settings::DEFAULTS.arduinoWillTopic;
+const char *serverStreamTopic     = Settings::DEFAULTS.serverStreamTopic;
+const char *serverWillTopic       = Settings::DEFAULTS.serverWillTopic;
+const char *arduinoSnapshotTopic  = Settings::DEFAULTS.arduinoSnapshotTopic;
+const char *arduinoTelemetryTopic = Settings::DEFAULTS.arduinoTelemetryTopic;
+const char *arduinoTraceTopic     = Settings::DEFAULTS.arduinoTraceTopic;
+
+const char *Settings::as_string(Result result) {
+    switch (result) {
+        case Result::OK:
+            return "ok";
+        case Result::UNKNOWN_KEY:
+            return "unknown key";
+        case Result::BAD_VALUE:
+            return "bad value";
+        case Result::FLASH_ERROR:
+            return "flash error";
+        default:
+            return "unknown result";
+    }
+}
+
+uint8_t Settings::count() { return FIELDS_COUNT; }
+
+const char *Settings::key(uint8_t index) {
+    return index < FIELDS_COUNT ? FIELDS[index].key : nullptr;
+}
+
+void Settings::begin() {
+    for (uint8_t i = 0; i < SLOTS; ++i) {
+        if (!valid(i)) continue;
+
+        if (loaded == NO_SLOT || int32_t(record(i)->sequence - record(loaded)->sequence) > 0) loaded = i;
+    }
+
+    const Values &values = loaded == NO_SLOT ? DEFAULTS : record(loaded)->values;
+    sequence = loaded == NO_SLOT ? 0 : record(loaded)->sequence;
+
+    apply(values);
+    staged.values = values;
+    dirty_        = false;
+
+    if (loaded == NO_SLOT) {
+        LOG_INFO("## Settings: compiled defaults");
+    } else {
+        LOG_INFO("## Settings: saved record %lu", (unsigned long) sequence);
+    }
+}
+
+Settings::Result Settings::set(const char *key, const char *value) {
+    const Field *field = find(key);
+    if (!field) return Result::UNKNOWN_KEY;
+
+    if (field->kind == PORT) {
+        char                *end;
+        const unsigned long port = strtoul(value, &end, 10);
+        if (end == value || *end || port == 0 || port > UINT16_MAX) return Result::BAD_VALUE;
+
+        staged.values.mqttPort = uint16_t(port);
+    } else {
+        if (strlen(value) >= field->size) return Result::BAD_VALUE;
+
+        strcpy(text(staged.values, *field), value);
+    }
+
+    dirty_ = true;
+    return Result::OK;
+}
+
+void Settings::defaults() {
+    staged.values = DEFAULTS;
+    dirty_        = true;
+}
+
+Settings::Result Settings::save() {
+    // the slot in use keeps the values the globals point to until the next reset
+    const uint8_t target = loaded == 0 ? 1 : 0;
+
+    staged.magic    = MAGIC;
+    staged.layout   = LAYOUT;
+    staged.size     = sizeof(Values);
+    staged.sequence = sequence + 1;
+    staged.crc      = recordCrc(staged);
+
+    const auto *to   = reinterpret_cast<const volatile uint8_t *>(record(target));
+    const auto *from = reinterpret_cast<const uint8_t *>(&staged);
+
+    for (uint32_t offset = 0; offset < SLOT_BYTES; offset += Flash::ROW_BYTES) {
+        if (!Flash::eraseRow(to + offset)) return Result::FLASH_ERROR;
+    }
+
+    for (uint32_t offset = 0; offset < sizeof(Record); offset += Flash::PAGE_BYTES) {
+        // the rest of the last page stays erased
+        uint8_t page[Flash::PAGE_BYTES];
+        memset(page, 0xff, sizeof(page));
+        memcpy(page, from + offset, min<uint32_t>(Flash::PAGE_BYTES, sizeof(Record) - offset));
+
+        if (!Flash::writePage(to + offset, page)) return Result::FLASH_ERROR;
+    }
+
+    if (!valid(target)) return Result::FLASH_ERROR;
+
+    dirty_ = false;
+    return Result::OK;
+}
+
+bool Settings::dirty() { return dirty_; }
+
+void Settings::print(Print &out) {
+    for (const Field &field: FIELDS) {
+        out.print(field.key);
+        out.print(" = ");
+
+        if (field.kind == PORT) {
+            out.println(staged.values.mqttPort);
+        } else if (field.secret && *text(staged.values, field)) {
+            out.println("********");
+        } else {
+            out.println(text(staged.values, field));
+        }
+    }
+
+    if (dirty_) out.println("(not saved)");
+}
@@ -0,0 +1,46 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_SETTINGS_H
+#define LETOVO_COMPUTERS_ARDUINO_SETTINGS_H
+
+#include <Arduino.h>
+
+// size of a text setting including the terminating zero
+#define SETTINGS_TEXT_MAX 64
+
+// Network settings (Wi-Fi, broker, topics). The defaults are compiled in from secrets.h and config.h, a record saved
+// in flash overrides them: begin() checks the newest record of two slots and points the globals of config.h into it,
+// no copy is made. Changes are staged in RAM by set() and written to the other slot by save(), so the slot in use is
+// never erased and a reset in the middle of a save keeps the previous record. Saved settings apply after a reset.
+namespace Settings {
+    enum class Result : uint8_t {
+        OK          = 0,
+        UNKNOWN_KEY = 1,
+        BAD_VALUE   = 2,  // too long, or not a port number
+        FLASH_ERROR = 3,
+    };
+
+    const char *as_string(Result result);
+
+    // number of the settings, their keys are the names of the macros in secrets.h / config.h
+    uint8_t count();
+
+    const char *key(uint8_t index);
+
+    void begin();
+
+    // stages a value given as text
+    Result set(const char *key, const char *value);
+
+    // stages the compiled-in defaults
+    void defaults();
+
+    // writes the staged settings to flash, the CPU stalls for a few rows erases
+    Result save();
+
+    // the staged settings differ from the saved ones
+    bool dirty();
+
+    // prints the staged settings, secrets are masked
+    void print(Print &out);
+}
+
+#endif //LETOVO_COMPUTERS_ARDUINO_SETTINGS_H
@@ -0,0 +1,325 @@
+#include "tag_directory.h"
+
+#include <algorithm>
+
+#include "flash.h"
+#include "log.h"
+#include "persistent.h"
+#include "rfid.h"
+
+namespace TagDirectory {
+    static_assert(TAG_DIRECTORY_TAGS % (Flash::ROW_BYTES / 4) == 0, "TAG_DIRECTORY_TAGS must fill whole flash rows");
+    static const uint32_t MAGIC          = 0x52494454;  // "TDIR"
+    static const uint8_t  BANKS          = 2;
+    static const uint8_t  NO_BANK        = BANKS;
+    static const uint32_t TAGS_PER_PAGE  = Flash::PAGE_BYTES / 4;
+    static const uint32_t PAGES_PER_ROW  = Flash::ROW_BYTES / Flash::PAGE_BYTES;
+    static const uint32_t TAGS_PER_ROW   = Flash::ROW_BYTES / 4;
+    static const uint32_t FENCE_ROWS     = TAG_DIRECTORY_TAGS / TAGS_PER_ROW;
+    // erased flash, also the end marker of a merge source
+    static const uint32_t NONE           = 0xffffffff;
+
+    struct Header {
+        uint32_t magic;
+        // the bank with the higher sequence is the newer one
+        uint32_t sequence;
+        uint32_t version;
+        uint32_t count;
+        uint32_t tagsCrc;
+        uint32_t crc;
+    };
+
+    // the header has a row of its own, so it can be erased first and written last
+    struct Bank {
+        Header   header;
+        uint8_t  padding[Flash::ROW_BYTES - sizeof(Header)];
+        uint32_t tags[TAG_DIRECTORY_TAGS];
+    };
+
+    // zero-filled by the upload, i.e. two invalid banks
+    __attribute__((aligned(Flash::ROW_BYTES))) static const Bank storage[BANKS] = {};
+
+    enum class Phase : uint8_t {
+        IDLE         = 0,
+        ERASE_HEADER = 1,  // invalidate the target bank before anything else is written to it
+        WRITE_TAGS   = 2,  // erase a row or write a page of merged tags per step
+        WRITE_HEADER = 3,  // the swap
+    };
+
+    static uint8_t active = NO_BANK;
+    static Stats   stats_ = {};
+
+    static void (*onCommit)(uint32_t version, bool ok) = nullptr;
+
+    // first tag of each row of the active bank
+    static uint32_t fence[FENCE_ROWS] = {};
+
+    // adds grow from the bottom, removes from the top
+    static uint32_t staged[TAG_DIRECTORY_BATCH_MAX];
+    static uint16_t addsCount    = 0;
+    static uint16_t removesCount = 0;
+    static bool     resetStaged  = false;
+
+    // state of the commit being written
+    static Phase    phase        = Phase::IDLE;
+    static uint8_t  target       = 0;
+    static uint32_t version_     = 0;
+    static uint32_t baseIndex    = 0;
+    static uint16_t addIndex     = 0;
+    static uint16_t removeIndex  = 0;
+    static uint32_t written      = 0;
+    static uint32_t tagsCrc      = 0;
+    static bool     rowErased    = false;
+
+    // the compiler must not assume the zeros of the initializer, the content is written at run time
+    static const Bank *bank(uint8_t index) {
+        const Bank *pointer = &storage[index];
+        asm volatile("" : "+r"(pointer));
+        return pointer;
+    }
+
+    static uint32_t headerCrc(const Header &header) {
+        return crc32(&header, offsetof(Header, crc));
+    }
+
+    static bool valid(uint8_t index) {
+        const Header &header = bank(index)->header;
+
+        return header.magic == MAGIC && header.crc == headerCrc(header) && header.count <= TAG_DIRECTORY_TAGS
+               && header.tagsCrc == crc32(bank(index)->tags, header.count * sizeof(uint32_t));
+    }
+
+    static uint32_t count() {
+        return active == NO_BANK ? 0 : bank(active)->header.count;
+    }
+
+    static uint32_t rows() {
+        return (count() + TAGS_PER_ROW - 1) / TAGS_PER_ROW;
+    }
+
+    static void buildFence() {
+        for (uint32_t row = 0; row < rows(); ++row) fence[row] = bank(active)->tags[row * TAGS_PER_ROW];
+    }
+
+    static uint32_t *removes() {
+        return staged + TAG_DIRECTORY_BATCH_MAX - removesCount;
+    }
+
+    static bool stageable() {
+        return phase == Phase::IDLE && addsCount + removesCount < TAG_DIRECTORY_BATCH_MAX;
+    }
+
+    // next tag of the new version: the union of the base bank and the adds, minus the removes, in order
+    static bool nextTag(uint32_t &tag) {
+        const Bank     *base      = bank(active == NO_BANK ? 0 : active);
+        const uint32_t baseCount  = resetStaged ? 0 : count();
+        const uint32_t *removed   = removes();
+
+        while (true) {
+            const uint32_t fromBase = baseIndex < baseCount ? base->tags[baseIndex] : NONE;
+            const uint32_t fromAdds = addIndex < addsCount ? staged[addIndex] : NONE;
+            if (fromBase == NONE && fromAdds == NONE) return false;
+
+            tag = min(fromBase, fromAdds);
+            if (fromBase == tag) ++baseIndex;
+            if (fromAdds == tag) ++addIndex;
+
+            while (removeIndex < removesCount && removed[removeIndex] < tag) ++removeIndex;
+            if (removeIndex < removesCount && removed[removeIndex] == tag) continue;
+
+            return true;
+        }
+    }
+
+    static void finish(bool ok) {
+        phase = Phase::IDLE;
+        addsCount    = 0;
+        removesCount = 0;
+        resetStaged  = false;
+
+        if (ok) {
+            active = target;
+            buildFence();
+            ++stats_.commits;
+            stats_.version = version_;
+            stats_.count   = uint16_t(count());
+        } else {
+            ++stats_.failedCommits;
+        }
+
+        if (ok) {
+            LOG_INFO("## Tag directory version %lu, %lu tags", (unsigned long) version_, (unsigned long) count());
+        } else {
+            LOG_ERROR("## Failed to write tag directory version %lu, %lu tags", (unsigned long) version_,
+                      (unsigned long) count());
+        }
+
+        if (onCommit) onCommit(version_, ok);
+    }
+
+    static bool writeTags() {
+        // the bank is full: fine if the merge is done, the row after the bank must not be erased either way
+        if (written == TAG_DIRECTORY_TAGS) {
+            uint32_t tag;
+            if (nextTag(tag)) return false;
+
+            phase = Phase::WRITE_HEADER;
+            return true;
+        }
+
+        const uint32_t page = written / TAGS_PER_PAGE;
+
+        // a new row has to be erased first, that is the whole step
+        if (page % PAGES_PER_ROW == 0 && !rowErased) {
+            rowErased = true;
+            return Flash::eraseRow(&bank(target)->tags[written]);
+        }
+
+        uint32_t buffer[TAGS_PER_PAGE];
+        uint8_t  filled = 0;
+
+        for (uint32_t tag; filled < TAGS_PER_PAGE && nextTag(tag); ++filled) {
+            buffer[filled] = tag;
+        }
+
+        if (!filled) {
+            phase = Phase::WRITE_HEADER;
+            return true;
+        }
+
+        // the rest of a partial page stays erased
+        for (uint8_t i = filled; i < TAGS_PER_PAGE; ++i) buffer[i] = NONE;
+
+        if (!Flash::writePage(&bank(target)->tags[written], buffer)) return false;
+
+        tagsCrc = crc32(buffer, filled * sizeof(uint32_t), tagsCrc);
+        written += filled;
+        if ((page + 1) % PAGES_PER_ROW == 0) rowErased = false;
+
+        if (filled < TAGS_PER_PAGE) phase = Phase::WRITE_HEADER;
+        return true;
+    }
+
+    static bool writeHeader() {
+        uint32_t buffer[TAGS_PER_PAGE];
+        memset(buffer, 0xff, sizeof(buffer));
+
+        Header header;
+        header.magic    = MAGIC;
+        header.sequence = active == NO_BANK ? 1 : bank(active)->header.sequence + 1;
+        header.version  = version_;
+        header.count    = written;
+        header.tagsCrc  = tagsCrc;
+        header.crc      = headerCrc(header);
+        memcpy(buffer, &header, sizeof(header));
+
+        return Flash::writePage(&bank(target)->header, buffer);
+    }
+}
+
+void TagDirectory::begin(void (*commitCallback)(uint32_t version, bool ok)) {
+    onCommit = commitCallback;
+
+    for (uint8_t i = 0; i < BANKS; ++i) {
+        if (!valid(i)) continue;
+
+        if (active == NO_BANK || int32_t(bank(i)->header.sequence - bank(active)->header.sequence) > 0) active = i;
+    }
+
+    if (active != NO_BANK) buildFence();
+
+    stats_.version = active == NO_BANK ? 0 : bank(active)->header.version;
+    stats_.count   = uint16_t(count());
+
+    LOG_INFO("## Tag directory version %lu, %u tags", (unsigned long) stats_.version, unsigned(stats_.count));
+}
+
+bool TagDirectory::contains(uint32_t tag) {
+    ++stats_.lookups;
+
+    const uint32_t rowsCount = rows();
+    if (!rowsCount || tag < fence[0] || tag > bank(active)->tags[count() - 1]) {
+        ++stats_.filtered;
+        return false;
+    }
+
+    // the last row whose first tag is not above the tag
+    const uint32_t row  = uint32_t(std::upper_bound(fence, fence + rowsCount, tag) - fence) - 1;
+    const uint32_t *tags = bank(active)->tags + row * TAGS_PER_ROW;
+    const uint32_t *end  = bank(active)->tags + min<uint32_t>((row + 1) * TAGS_PER_ROW, count());
+
+    const bool found = std::binary_search(tags, end, tag);
+    if (found) ++stats_.hits;
+
+    return found;
+}
+
+bool TagDirectory::reset() {
+    if (phase != Phase::IDLE) return false;
+
+    // staged adds of the same batch stay, removes are meaningless on an empty base
+    resetStaged  = true;
+    removesCount = 0;
+    return true;
+}
+
+bool TagDirectory::add(uint32_t tag) {
+    if (!stageable() || tag == NONE) return false;
+
+    staged[addsCount++] = tag;
+    return true;
+}
+
+bool TagDirectory::remove(uint32_t tag) {
+    if (!stageable()) return false;
+
+    ++removesCount;
+    removes()[0] = tag;
+    return true;
+}
+
+bool TagDirectory::commit(uint32_t version) {
+    if (phase != Phase::IDLE) return false;
+
+    std::sort(staged, staged + addsCount);
+    addsCount = uint16_t(std::unique(staged, staged + addsCount) - staged);
+    std::sort(removes(), removes() + removesCount);
+
+    version_    = version;
+    target      = active == 0 ? 1 : 0;
+    baseIndex   = 0;
+    addIndex    = 0;
+    removeIndex = 0;
+    written     = 0;
+    tagsCrc     = 0;
+    rowErased   = false;
+    phase       = Phase::ERASE_HEADER;
+    return true;
+}
+
+bool TagDirectory::busy() { return phase != Phase::IDLE; }
+
+void TagDirectory::step(__attribute__((unused)) Task *me) {
+    // the UART interrupts stall with the CPU during an erase or a write, the bytes of a frame would be lost
+    if (phase != Phase::IDLE && !Rfid::idle()) return;
+
+    switch (phase) {
+        case Phase::IDLE:
+            return;
+        case Phase::ERASE_HEADER:
+            if (Flash::eraseRow(&bank(target)->header)) {
+                phase = Phase::WRITE_TAGS;
+            } else {
+                finish(false);
+            }
+            return;
+        case Phase::WRITE_TAGS:
+            if (!writeTags()) finish(false);
+            return;
+        case Phase::WRITE_HEADER:
+            finish(writeHeader());
+            return;
+    }
+}
+
+const TagDirectory::Stats &TagDirectory::stats() { return stats_; }
@@ -0,0 +1,55 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_TAG_DIRECTORY_H
+#define LETOVO_COMPUTERS_ARDUINO_TAG_DIRECTORY_H
+
+#include <Arduino.h>
+#include <SoftTimer.h>
+
+// max number of tags of the directory, a multiple of 64; two banks of this size are reserved in flash
+#ifndef TAG_DIRECTORY_TAGS
+#define TAG_DIRECTORY_TAGS 8192
+#endif
+// max number of added and removed tags staged for one commit
+#define TAG_DIRECTORY_BATCH_MAX 256
+// Read-mostly directory of allowed tags in flash: a sorted array in one of two banks, with a fence index in RAM (the
+// first tag of every flash row, 4 bytes per 64 tags) that narrows the binary search down to a single row. Updates are
+// staged in RAM, merged with the active bank into the other bank by step() one flash row or page at a time, and
+// swapped in by writing the header last, so a reset in the middle of an update leaves the previous version in place.
+// The CPU stalls while a row is erased or a page written, so step() waits until no RFID frame is coming in.
+namespace TagDirectory {
+    struct Stats {
+        // version given by the server with the latest commit, 0 if the directory is empty
+        uint32_t version;
+        uint16_t count;
+        uint16_t lookups;
+        // lookups of tags outside the range of the directory, answered by the fence index alone
+        uint16_t filtered;
+        uint16_t hits;
+        uint16_t commits;
+        // the directory overflowed or a flash operation failed
+        uint16_t failedCommits;
+    };
+
+    // picks the newest valid bank and builds the Bloom filter; onCommit is called when a commit has finished
+    void begin(void (*onCommit)(uint32_t version, bool ok));
+
+    bool contains(uint32_t tag);
+
+    // the next commit starts from an empty directory instead of the current one
+    bool reset();
+
+    // staging fails while a commit is being written or when the batch is full
+    bool add(uint32_t tag);
+
+    bool remove(uint32_t tag);
+
+    // starts writing the staged changes as the given version
+    bool commit(uint32_t version);
+
+    bool busy();
+
+    void step(Task *me);
+
+    const Stats &stats();
+}
+
+#endif //LETOVO_COMPUTERS_ARDUINO_TAG_DIRECTORY_H
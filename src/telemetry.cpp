@@ -0,0 +1,276 @@
+#include "telemetry.h"
+
+#include <malloc.h>
+#include <unistd.h>
+
+#include <Arduino_JSON.h>
+#include <WiFiNINA.h>
+
+#include "boot.h"
+#include "config.h"
+#include "connection.h"
+#include "dispatch.h"
+#include "heap.h"
+#include "outbound.h"
+
+// top of the RAM, the stack grows down from here (defined by the linker script)
+extern "C" char __StackTop;
+
+namespace Telemetry {
+    enum Metric : uint8_t {
+        HEAP     = 0,
+        STACK    = 1,
+        RSSI     = 2,
+        CONNECTS = 3,
+        LATENCY  = 4,
+        QUEUES   = 5,
+        DROPPED  = 6,
+        BOOT     = 7,
+        ALLOC    = 8,
+        METRICS  = 9,
+    };
+
+    struct MetricInfo {
+        const char *key;
+        uint8_t    size;
+        // smaller changes are not reported, so noisy metrics do not make every report full
+        int32_t    tolerance;
+    };
+
+    static const uint8_t VALUES_MAX = 6;
+
+    static_assert(Boot::PHASES <= VALUES_MAX, "boot phases do not fit into a metric");
+
+    static const MetricInfo METRIC_INFO[METRICS] = {
+            {"heap",  2, 64},  // free bytes, largest free block
+            {"stack", 1, 16},  // high-water mark in bytes
+            {"rssi",  1, 3},   // dBm, 0 if Wi-Fi is down
+            {"conn",  4, 0},   // Wi-Fi connects, broker connects, Wi-Fi failures, broker failures
+            {"lat",   6, 0},   // p50, p90, p99 publish latency in ms of the interactive, then the inventory class
+            {"queue", 6, 0},   // depth of each class, then the peak depth of each class
+            {"drop",  3, 0},   // dropped messages of each class
+            {"boot",  6, 0},   // ms after the reset of each boot phase, 0 until reached
+            {"alloc", 4, 16},  // bytes allocated, peak bytes, heap allocations after setup(), pool blocks in use
+    };
+
+    // task run time: load in 1/1000 of the interval, longest run in us
+    static const int32_t TASK_TOLERANCE[2] = {5, 200};
+
+    static const uint32_t STACK_PAINT       = 0xa5a5a5a5;
+    // the painting stops this far below the stack pointer of begin()
+    static const uint32_t STACK_PAINT_GUARD = 64;
+
+    static int32_t sent[METRICS][VALUES_MAX] = {};
+
+    static const TaskInfo *tasks     = nullptr;
+    static uint8_t        tasksCount = 0;
+    static unsigned long  taskRunMicros[TELEMETRY_TASKS_MAX] = {};
+    static int32_t        taskSent[TELEMETRY_TASKS_MAX][2]   = {};
+
+    static int32_t commandSent[Dispatch::COMMANDS_MAX][2] = {};
+    static int32_t unknownSent                            = 0;
+
+    static uint32_t      *paintedFrom = nullptr;
+    static unsigned long reportedAt   = 0;
+    static uint16_t      reports      = 0;
+
+    static uint32_t *heapTop() {
+        const uintptr_t top = reinterpret_cast<uintptr_t>(sbrk(0));
+        return reinterpret_cast<uint32_t *>((top + 3) & ~uintptr_t(3));
+    }
+
+    static bool changed(const int32_t *values, const int32_t *previous, uint8_t size, int32_t tolerance) {
+        for (uint8_t i = 0; i < size; ++i) {
+            if (abs(values[i] - previous[i]) > tolerance) return true;
+        }
+        return false;
+    }
+
+    static void collect(int32_t (&values)[METRICS][VALUES_MAX]) {
+        // freed chunks inside the heap are usually smaller than the gap, so they are not counted as the largest block
+        values[HEAP][0] = int32_t(mallinfo().fordblks + heapGap());
+        values[HEAP][1] = int32_t(Heap::largestFree());
+
+        values[STACK][0] = int32_t(stackHighWaterMark());
+
+        values[RSSI][0] = WiFi.status() == WL_CONNECTED ? WiFi.RSSI() : 0;
+
+        const Connection::Stats &connection = Connection::stats();
+        values[CONNECTS][0] = connection.wifiConnects;
+        values[CONNECTS][1] = connection.brokerConnects;
+        values[CONNECTS][2] = connection.wifiFailures;
+        values[CONNECTS][3] = connection.brokerFailures;
+
+        // percentiles of the messages sent since the previous report
+        for (uint8_t i = 0; i < 2; ++i) {
+            const auto cls = Outbound::Class(Outbound::INTERACTIVE + i);
+
+            values[LATENCY][3 * i]     = int32_t(Outbound::latencyPercentile(cls, 50));
+            values[LATENCY][3 * i + 1] = int32_t(Outbound::latencyPercentile(cls, 90));
+            values[LATENCY][3 * i + 2] = int32_t(Outbound::latencyPercentile(cls, 99));
+            Outbound::resetLatency(cls);
+        }
+
+        for (uint8_t cls = 0; cls < Outbound::CLASSES; ++cls) {
+            const Outbound::Stats &outbound = Outbound::stats(Outbound::Class(cls));
+
+            values[QUEUES][cls]                     = outbound.depth;
+            values[QUEUES][Outbound::CLASSES + cls] = outbound.peakDepth;
+            values[DROPPED][cls]                    = outbound.dropped;
+        }
+
+        // rounded up, so a reached phase is never 0
+        for (uint8_t phase = 0; phase < Boot::PHASES; ++phase) {
+            const uint32_t at = Boot::at(Boot::Phase(phase));
+            values[BOOT][phase] = int32_t((at + 999) / 1000);
+        }
+
+        const Heap::Stats &heap = Heap::stats();
+        values[ALLOC][0] = int32_t(heap.bytes);
+        values[ALLOC][1] = int32_t(heap.peakBytes);
+        values[ALLOC][2] = int32_t(heap.heapAllocations);
+        for (uint8_t pool = 0; pool < Heap::POOLS; ++pool) {
+            values[ALLOC][3] += Heap::poolStats(Heap::PoolIndex(pool)).used;
+        }
+    }
+
+    static bool reportTasks(JSONVar &report, unsigned long elapsedMicros, bool full) {
+        bool any = false;
+
+        for (uint8_t i = 0; i < tasksCount; ++i) {
+            Task *task = tasks[i].task;
+
+            const int32_t values[2] = {
+                    int32_t((task->runMicros - taskRunMicros[i]) / max(elapsedMicros / 1000, 1UL)),
+                    int32_t(task->maxRunMicros),
+            };
+            taskRunMicros[i]   = task->runMicros;
+            task->maxRunMicros = 0;
+
+            if (!full && !changed(values, taskSent[i], 1, TASK_TOLERANCE[0])
+                && !changed(values + 1, taskSent[i] + 1, 1, TASK_TOLERANCE[1])) {
+                continue;
+            }
+
+            report["task"][tasks[i].name][0] = values[0];
+            report["task"][tasks[i].name][1] = values[1];
+            memcpy(taskSent[i], values, sizeof(values));
+            any = true;
+        }
+
+        return any;
+    }
+
+    // handled and rejected commands of each status code that has seen any, and the messages without a handler
+    static bool reportCommands(JSONVar &report, bool full) {
+        bool any = false;
+
+        for (uint8_t status = 0; status < Dispatch::COMMANDS_MAX; ++status) {
+            const Dispatch::Counters &counters = Dispatch::counters(status);
+            const int32_t values[2] = {counters.handled, counters.rejected};
+
+            if (!values[0] && !values[1]) continue;
+            if (!full && !changed(values, commandSent[status], 2, 0)) continue;
+
+            char code[4];
+            snprintf(code, sizeof(code), "%u", unsigned(status));
+            const char *key = code;
+            report["cmd"][key][0] = values[0];
+            report["cmd"][key][1] = values[1];
+            memcpy(commandSent[status], values, sizeof(values));
+            any = true;
+        }
+
+        const int32_t unknown = Dispatch::unknown();
+        if (unknown != unknownSent || (full && unknown)) {
+            report["cmd"]["unknown"] = unknown;
+            unknownSent = unknown;
+            any = true;
+        }
+
+        return any;
+    }
+}
+
+void Telemetry::begin(const TaskInfo *taskInfos, uint8_t count) {
+    tasks      = taskInfos;
+    tasksCount = count;
+
+    for (uint8_t i = 0; i < tasksCount; ++i) {
+        taskRunMicros[i] = tasks[i].task->runMicros;
+    }
+
+    // everything between the heap and the current stack frame is unused yet
+    char here;
+    auto *to = reinterpret_cast<uint32_t *>(reinterpret_cast<uintptr_t>(&here - STACK_PAINT_GUARD) & ~uintptr_t(3));
+
+    paintedFrom = heapTop();
+    for (uint32_t *word = paintedFrom; word < to; ++word) *word = STACK_PAINT;
+
+    reportedAt = micros();
+}
+
+void Telemetry::publish(__attribute__((unused)) Task *me) {
+    const unsigned long now = micros();
+    const unsigned long elapsedMicros = now - reportedAt;
+    reportedAt = now;
+
+    int32_t values[METRICS][VALUES_MAX] = {};
+    collect(values);
+
+    const bool full = reports++ % TELEMETRY_FULL_EVERY == 0;
+
+    JSONVar report;
+    report["up"] = int32_t(millis() / 1000);
+    if (full) report["full"] = true;
+
+    bool any = false;
+    for (uint8_t metric = 0; metric < METRICS; ++metric) {
+        const MetricInfo &info = METRIC_INFO[metric];
+
+        if (!full && !changed(values[metric], sent[metric], info.size, info.tolerance)) continue;
+
+        for (uint8_t i = 0; i < info.size; ++i) {
+            report[info.key][i] = values[metric][i];
+        }
+        memcpy(sent[metric], values[metric], sizeof(sent[metric]));
+        any = true;
+    }
+
+    // the task run times go separately, both halves of a full report would not fit into one message
+    JSONVar taskReport;
+    taskReport["up"] = report["up"];
+
+    // nothing changed: the uptime alone is not worth a message,
+    // a lost report only delays the changed metrics until the next full report
+    if (any) Outbound::enqueue(Outbound::TELEMETRY, arduinoTelemetryTopic, JSON.stringify(report).c_str(), false);
+
+    if (reportTasks(taskReport, elapsedMicros, full)) {
+        Outbound::enqueue(Outbound::TELEMETRY, arduinoTelemetryTopic, JSON.stringify(taskReport).c_str(), false);
+    }
+
+    // the command counters change rarely, they go in a message of their own too
+    JSONVar commandReport;
+    commandReport["up"] = report["up"];
+
+    if (reportCommands(commandReport, full)) {
+        Outbound::enqueue(Outbound::TELEMETRY, arduinoTelemetryTopic, JSON.stringify(commandReport).c_str(), false);
+    }
+}
+
+uint32_t Telemetry::heapGap() {
+    char here;
+    return uint32_t(&here - reinterpret_cast<char *>(sbrk(0)));
+}
+
+uint32_t Telemetry::stackHighWaterMark() {
+    if (!paintedFrom) return 0;
+
+    // the heap may have grown over the bottom of the painted area since
+    const uint32_t *word = max(paintedFrom, heapTop());
+
+    char here;
+    while (reinterpret_cast<const char *>(word) < &here && *word == STACK_PAINT) ++word;
+
+    return uint32_t(&__StackTop - reinterpret_cast<const char *>(word));
+}
@@ -0,0 +1,31 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_TELEMETRY_H
+#define LETOVO_COMPUTERS_ARDUINO_TELEMETRY_H
+
+#include <SoftTimer.h>
+
+// max number of tasks whose run time is reported, the task table in main.cpp is checked against it at compile time
+#define TELEMETRY_TASKS_MAX 16
+
+// Periodic device health report. Only the metrics that changed noticeably since the previous report are published,
+// every TELEMETRY_FULL_EVERY-th report is complete, so a new subscriber gets the whole picture in a bounded time.
+namespace Telemetry {
+    struct TaskInfo {
+        // short key of the task in the report
+        const char *name;
+        Task       *task;
+    };
+
+    // paints the free stack, so it has to be called from setup() before the stack gets deep.
+    // count must not exceed TELEMETRY_TASKS_MAX
+    void begin(const TaskInfo *tasks, uint8_t count);
+
+    void publish(Task *me);
+
+    // bytes between the top of the heap and the stack pointer
+    uint32_t heapGap();
+
+    // deepest stack use since begin() in bytes
+    uint32_t stackHighWaterMark();
+}
+
+#endif //LETOVO_COMPUTERS_ARDUINO_TELEMETRY_H
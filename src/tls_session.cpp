@@ -0,0 +1,159 @@
+#include "tls_session.h"
+
+#if USE_SSL
+#include <ArduinoBearSSL.h>
+
+#include "log.h"
+#include "persistent.h"
+
+namespace TlsSession {
+    static const uint32_t CACHE_MAGIC = 0x544c5331;  // "TLS1"
+
+    struct Cache {
+        uint32_t                  magic;
+        // the session is only offered to the server it was negotiated with
+        uint32_t                  hostHash;
+        br_ssl_session_parameters params;
+        uint32_t                  crc;
+    };
+
+#if TLS_SESSION_PERSIST
+    // survives warm resets, so a watchdog reset does not cost a full handshake either
+    NOINIT static Cache cache;
+#else
+    static Cache cache;
+#endif
+
+    static Stats stats_ = {};
+
+    // set by the br_ssl_client_reset() wrapper, i.e. right after the TCP connection was made
+    static br_ssl_engine_context *engine     = nullptr;
+    static unsigned long         startedAt   = 0;
+    static bool                  offered     = false;
+    static uint32_t              pendingHost = 0;
+
+    static uint32_t hostHash(const char *host) {
+        return host ? crc32(host, strlen(host)) : 0;
+    }
+
+    static uint32_t cacheCrc() {
+        return crc32(&cache, offsetof(Cache, crc));
+    }
+
+    static bool cacheValid() {
+        return cache.magic == CACHE_MAGIC && cache.crc == cacheCrc();
+    }
+
+    static void store(uint32_t host, const br_ssl_session_parameters &params) {
+        cache.magic    = CACHE_MAGIC;
+        cache.hostHash = host;
+        cache.params   = params;
+        cache.crc      = cacheCrc();
+    }
+
+    static void onConnect(int result) {
+        if (!startedAt) return;  // TCP connection failed, no handshake was made
+
+        const unsigned long elapsed = millis() - startedAt;
+        startedAt = 0;
+
+        if (!result) {
+            // the server might have choked on the offered session, do not offer it again
+            ++stats_.failedHandshakes;
+            invalidate();
+
+            LOG_WARN("## TLS handshake failed after %lu ms", elapsed);
+            return;
+        }
+
+        br_ssl_session_parameters params;
+        br_ssl_engine_get_session_parameters(engine, &params);
+
+        // the server echoes the offered session id only if it agreed to resume
+        const bool resumed = offered
+                             && params.session_id_len == cache.params.session_id_len
+                             && !memcmp(params.session_id, cache.params.session_id, params.session_id_len);
+
+        if (resumed) {
+            ++stats_.resumedHandshakes;
+            stats_.resumedMillis += elapsed;
+        } else {
+            ++stats_.fullHandshakes;
+            stats_.fullMillis += elapsed;
+        }
+        stats_.lastMillis  = elapsed;
+        stats_.lastResumed = resumed;
+
+        if (params.session_id_len) {
+            store(pendingHost, params);
+        } else {
+            invalidate();
+        }
+
+        LOG_INFO(resumed ? "## TLS session resumed in %lu ms" : "## TLS full handshake in %lu ms", elapsed);
+    }
+}
+
+extern "C" {
+int __real_br_ssl_client_reset(br_ssl_client_context *cc, const char *server_name, int resume_session);
+
+// br_ssl_client_init_full() zeroed the context just before this call, so this is the only point where the
+// session parameters can be put back before the ClientHello is built
+int __wrap_br_ssl_client_reset(br_ssl_client_context *cc, const char *server_name, int resume_session) {
+    using namespace TlsSession;
+
+    engine      = &cc->eng;
+    startedAt   = millis();
+    pendingHost = hostHash(server_name);
+    offered     = cacheValid() && cache.hostHash == pendingHost;
+
+    if (offered) {
+        br_ssl_engine_set_session_parameters(&cc->eng, &cache.params);
+        resume_session = 1;
+    }
+
+    return __real_br_ssl_client_reset(cc, server_name, resume_session);
+}
+}
+
+void TlsSession::begin(MqttTransport &transport) {
+    transport.setConnectHook(onConnect);
+
+    if (cacheValid()) {
+        LOG_INFO("## TLS session of the previous boot found");
+    } else {
+        invalidate();
+    }
+}
+
+void TlsSession::invalidate() {
+    memset(&cache, 0, sizeof(cache));
+}
+
+const TlsSession::Stats &TlsSession::stats() { return stats_; }
+
+void TlsSession::benchmarkStep(__attribute__((unused)) MqttClient &client) {
+#if TLS_BENCHMARK_ROUNDS
+    static uint8_t round = 0;
+
+    if (round < 2 * TLS_BENCHMARK_ROUNDS) {
+        // rounds alternate between an empty and a warm cache: full, resumed, full, resumed, ...
+        if (round % 2 == 0) invalidate();
+        ++round;
+
+        LOG_INFO("## TLS benchmark round %u", round);
+
+        client.stop();
+        return;
+    }
+    if (round > 2 * TLS_BENCHMARK_ROUNDS) return;
+    ++round;
+
+    LOG_INFO("## TLS benchmark: full handshake avg %lu ms (%u), resumed avg %lu ms (%u)",
+             (unsigned long) (stats_.fullHandshakes ? stats_.fullMillis / stats_.fullHandshakes : 0),
+             unsigned(stats_.fullHandshakes),
+             (unsigned long) (stats_.resumedHandshakes ? stats_.resumedMillis / stats_.resumedHandshakes : 0),
+             unsigned(stats_.resumedHandshakes));
+#endif
+}
+#endif
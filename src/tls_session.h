@@ -0,0 +1,43 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_TLS_SESSION_H
+#define LETOVO_COMPUTERS_ARDUINO_TLS_SESSION_H
+
+#include "config.h"
+
+#if USE_SSL
+#include <ArduinoMqttClient.h>
+
+#include "transport.h"
+
+// TLS session resumption for BearSSLClient. BearSSLClient always starts a full handshake, so the linker redirects
+// its call to br_ssl_client_reset() (-Wl,--wrap=br_ssl_client_reset in platformio.ini) to a wrapper that loads the
+// parameters of the previous session into the engine and asks for an abbreviated handshake. The server decides
+// whether to resume; if it does not, a full handshake follows as before.
+namespace TlsSession {
+    struct Stats {
+        uint16_t fullHandshakes;
+        uint16_t resumedHandshakes;
+        uint16_t failedHandshakes;
+        // total time spent in handshakes of each kind, ms
+        uint32_t fullMillis;
+        uint32_t resumedMillis;
+        // the latest handshake
+        uint32_t lastMillis;
+        bool     lastResumed;
+    };
+
+    // hooks the handshake timing into the transport; with TLS_SESSION_PERSIST the cached session
+    // of the previous boot is picked up if it survived the reset
+    void begin(MqttTransport &transport);
+
+    // drop the cached session, the next handshake will be a full one
+    void invalidate();
+
+    const Stats &stats();
+
+    // call when the connection is ready: with TLS_BENCHMARK_ROUNDS > 0 drops the connection that many times
+    // alternating full and resumed handshakes, then prints the average time of each kind
+    void benchmarkStep(MqttClient &client);
+}
+#endif
+
+#endif //LETOVO_COMPUTERS_ARDUINO_TLS_SESSION_H
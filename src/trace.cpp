@@ -0,0 +1,179 @@
+#include "trace.h"
+
+#include <Arduino_JSON.h>
+
+#include "config.h"
+#include "outbound.h"
+
+namespace Trace {
+    struct Span {
+        uint16_t id;
+        Kind     kind;
+        // bit i is set if stage i was reached
+        uint8_t  reached;
+        uint32_t at[STAGES];
+    };
+
+    // all stages a trace of the kind can reach, it is closed early when it has them
+    static const uint8_t COMPLETE[KINDS] = {
+            (1 << CAPTURED) | (1 << PUBLISH_BEGIN) | (1 << PUBLISH_END) | (1 << ACKED) | (1 << OPEN_RECEIVED)
+            | (1 << ACTUATED),
+            (1 << CAPTURED) | (1 << PUBLISH_BEGIN) | (1 << PUBLISH_END) | (1 << ACKED),
+    };
+
+    static Span     active[TRACE_ACTIVE_MAX] = {};
+    static Span     log_[TRACE_LOG_MAX]      = {};
+    static uint8_t  logNext                  = 0;
+    static uint16_t histograms[KINDS][STAGES][TRACE_BUCKETS] = {};
+    static uint16_t nextId                   = 1;
+
+    // export cursor: histograms first, one per kind and stage, then the log
+    static bool    exporting   = false;
+    static uint8_t exportIndex = 0;
+
+    static void close(Span &span) {
+        for (uint8_t stage = 0; stage < STAGES; ++stage) {
+            if (!(span.reached & (1 << stage))) continue;
+
+            uint8_t bucket = 0;
+            for (uint32_t units = (span.at[stage] - span.at[CAPTURED]) / TRACE_UNIT_US; units; units >>= 1) ++bucket;
+
+            uint16_t &count = histograms[span.kind][stage][min<uint8_t>(bucket, TRACE_BUCKETS - 1)];
+            if (count < UINT16_MAX) ++count;
+        }
+
+        log_[logNext] = span;
+        logNext = (logNext + 1) % TRACE_LOG_MAX;
+
+        span.id = 0;
+    }
+
+    static Span *find(uint16_t id) {
+        if (!id) return nullptr;
+
+        for (Span &span: active) {
+            if (span.id == id) return &span;
+        }
+        return nullptr;
+    }
+
+    static bool exportNext() {
+        JSONVar message;
+
+        const uint8_t histogramsCount = KINDS * STAGES;
+        if (exportIndex < histogramsCount) {
+            const Kind  kind  = Kind(exportIndex / STAGES);
+            const Stage stage = Stage(exportIndex % STAGES);
+
+            message["kind"]  = as_string(kind);
+            message["stage"] = as_string(stage);
+            message["unit"]  = TRACE_UNIT_US;
+            for (uint8_t i = 0; i < TRACE_BUCKETS; ++i) message["hist"][i] = histograms[kind][stage][i];
+        } else {
+            // oldest first
+            const Span &span = log_[(logNext + exportIndex - histogramsCount) % TRACE_LOG_MAX];
+            if (!span.id) return true;
+
+            message["id"]   = span.id;
+            message["kind"] = as_string(span.kind);
+            // us after the capture, -1 if the stage was not reached
+            for (uint8_t stage = 0; stage < STAGES; ++stage) {
+                message["at"][stage] = span.reached & (1 << stage) ? double(span.at[stage] - span.at[CAPTURED]) : -1.0;
+            }
+        }
+
+        return Outbound::enqueue(Outbound::TELEMETRY, arduinoTraceTopic, JSON.stringify(message).c_str(), false);
+    }
+}
+
+const char *Trace::as_string(Kind kind) {
+    switch (kind) {
+        case SCAN:
+            return "scan";
+        case SLOT:
+            return "slot";
+        default:
+            return "unknown";
+    }
+}
+
+const char *Trace::as_string(Stage stage) {
+    switch (stage) {
+        case CAPTURED:
+            return "captured";
+        case PUBLISH_BEGIN:
+            return "publish begin";
+        case PUBLISH_END:
+            return "publish end";
+        case ACKED:
+            return "acked";
+        case OPEN_RECEIVED:
+            return "open received";
+        case ACTUATED:
+            return "actuated";
+        default:
+            return "unknown";
+    }
+}
+
+uint16_t Trace::start(Kind kind, uint32_t capturedAt) {
+    Span *slot = &active[0];
+    for (Span &span: active) {
+        if (!span.id) {
+            slot = &span;
+            break;
+        }
+        if (int32_t(span.at[CAPTURED] - slot->at[CAPTURED]) < 0) slot = &span;
+    }
+    if (slot->id) close(*slot);
+
+    slot->id           = nextId;
+    slot->kind         = kind;
+    slot->reached      = 1 << CAPTURED;
+    slot->at[CAPTURED] = capturedAt;
+
+    nextId = nextId == UINT16_MAX ? 1 : nextId + 1;
+    return slot->id;
+}
+
+void Trace::mark(uint16_t id, Stage stage) {
+    Span *span = find(id);
+    if (!span || span->reached & (1 << stage)) return;
+
+    span->at[stage] = micros();
+    span->reached |= 1 << stage;
+
+    if (span->reached == COMPLETE[span->kind]) close(*span);
+}
+
+uint16_t Trace::pending(Kind kind, Stage stage) {
+    const Span *newest = nullptr;
+
+    for (const Span &span: active) {
+        if (!span.id || span.kind != kind || span.reached & (1 << stage)) continue;
+        if (!newest || int32_t(span.at[CAPTURED] - newest->at[CAPTURED]) > 0) newest = &span;
+    }
+    return newest ? newest->id : 0;
+}
+
+void Trace::step(__attribute__((unused)) Task *me) {
+    const uint32_t now = micros();
+
+    // a SCAN of a tag the server does not open for never reaches the last stages
+    for (Span &span: active) {
+        if (span.id && now - span.at[CAPTURED] > TRACE_TIMEOUT_MS * 1000) close(span);
+    }
+
+    if (!exporting) return;
+
+    // only as fast as the telemetry class drains, so the export never pushes out other telemetry
+    if (Outbound::stats(Outbound::TELEMETRY).depth) return;
+    if (!exportNext()) return;
+
+    if (++exportIndex == KINDS * STAGES + TRACE_LOG_MAX) exporting = false;
+}
+
+void Trace::requestExport() {
+    exporting   = true;
+    exportIndex = 0;
+}
@@ -0,0 +1,56 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_TRACE_H
+#define LETOVO_COMPUTERS_ARDUINO_TRACE_H
+
+#include <Arduino.h>
+#include <SoftTimer.h>
+
+// number of traces followed at the same time, the oldest one is closed when another one starts
+#define TRACE_ACTIVE_MAX 4
+// number of closed traces kept for the export
+#define TRACE_LOG_MAX 8
+// histogram bucket i counts stages reached within [2^(i-1), 2^i) units after the capture
+#define TRACE_BUCKETS 16
+// histogram unit in us
+#define TRACE_UNIT_US 256
+
+// Latency tracing of the two user facing paths: tag scan to door and slot change to acknowledged PLACE/TAKE.
+// Each event gets a trace id at capture, and every stage it passes stamps the time. A closed trace adds the time from
+// the capture to each stage it reached to a per-stage histogram, and is kept for the export until pushed out.
+namespace Trace {
+    enum Kind : uint8_t {
+        SCAN  = 0,
+        SLOT  = 1,
+        KINDS = 2,
+    };
+
+    enum Stage : uint8_t {
+        CAPTURED      = 0,  // RDM6300 frame complete / key matrix edge seen
+        PUBLISH_BEGIN = 1,  // the scheduler started the publish
+        PUBLISH_END   = 2,  // the message is written to the socket
+        ACKED         = 3,  // PUBACK/PUBCOMP received
+        OPEN_RECEIVED = 4,  // OPEN command from the server
+        ACTUATED      = 5,  // servo commanded, by the OPEN or by a local grant
+        STAGES        = 6,
+    };
+
+    const char *as_string(Kind kind);
+
+    const char *as_string(Stage stage);
+
+    // capturedAt - micros() of the capture, returns the trace id (never 0)
+    uint16_t start(Kind kind, uint32_t capturedAt);
+
+    // stamps the stage with micros(); the first stamp of a stage counts, id 0 and closed traces are ignored
+    void mark(uint16_t id, Stage stage);
+
+    // the newest active trace of the kind that has not reached the stage yet, 0 if none
+    uint16_t pending(Kind kind, Stage stage);
+
+    // closes timed out traces and feeds the export
+    void step(Task *me);
+
+    // publishes the histograms and the logged traces to the trace topic over the next steps
+    void requestExport();
+}
+
+#endif //LETOVO_COMPUTERS_ARDUINO_TRACE_H
@@ -0,0 +1,226 @@
+#include "transport.h"
+
+// MQTT 3.1.1 control packet types (high nibble of the fixed header)
+#define MQTT_CONNACK 2
+#define MQTT_PUBLISH 3
+#define MQTT_PUBACK  4
+#define MQTT_PUBREC  5
+#define MQTT_PUBREL  6
+#define MQTT_PUBCOMP 7
+
+int MqttTransport::connect(IPAddress ip, uint16_t port) {
+    resetParsers();
+
+    const int result = _client.connect(ip, port);
+    if (_connectHook) _connectHook(result);
+    return result;
+}
+
+int MqttTransport::connect(const char *host, uint16_t port) {
+    resetParsers();
+
+    const int result = _client.connect(host, port);
+    if (_connectHook) _connectHook(result);
+    return result;
+}
+
+size_t MqttTransport::write(uint8_t b) {
+    const size_t written = _client.write(b);
+    feedOutgoing(&b, written);
+    return written;
+}
+
+size_t MqttTransport::write(const uint8_t *buf, size_t size) {
+    const size_t written = _client.write(buf, size);
+    feedOutgoing(buf, written);
+    return written;
+}
+
+int MqttTransport::read() {
+    const int b = _client.read();
+    if (b >= 0) {
+        const uint8_t byte = b;
+        feedIncoming(&byte, 1);
+    }
+    return b;
+}
+
+int MqttTransport::read(uint8_t *buf, size_t size) {
+    const int n = _client.read(buf, size);
+    if (n > 0) feedIncoming(buf, n);
+    return n;
+}
+
+void MqttTransport::stop() {
+    _client.stop();
+    resetParsers();
+}
+
+bool MqttTransport::isInflight(uint16_t packetId) const {
+    if (!packetId) return false;
+
+    for (uint16_t id: _inflight) {
+        if (id == packetId) return true;
+    }
+    return false;
+}
+
+uint8_t MqttTransport::inflightCount() const {
+    uint8_t count = 0;
+    for (uint16_t id: _inflight) {
+        if (id) ++count;
+    }
+    return count;
+}
+
+void MqttTransport::forget(uint16_t packetId) {
+    if (!packetId) return;
+
+    for (uint16_t &id: _inflight) {
+        if (id == packetId) id = 0;
+    }
+}
+
+bool MqttTransport::republish(const char *topic, const uint8_t *payload, size_t length, bool retain, uint8_t qos,
+                              uint16_t packetId) {
+    const size_t topicLength = strlen(topic);
+
+    // fixed header: type, DUP, QoS, RETAIN, then the remaining length in 7-bit groups
+    uint8_t  header[5];
+    uint8_t  headerLength = 0;
+    uint32_t remaining    = 2 + topicLength + 2 + length;
+
+    header[headerLength++] = MQTT_PUBLISH << 4 | 0x08 | qos << 1 | (retain ? 0x01 : 0x00);
+    do {
+        const uint8_t b = remaining & 0x7f;
+        remaining >>= 7;
+        header[headerLength++] = remaining ? b | 0x80 : b;
+    } while (remaining);
+
+    const uint8_t topicHeader[2] = {uint8_t(topicLength >> 8), uint8_t(topicLength)};
+    const uint8_t id[2]          = {uint8_t(packetId >> 8), uint8_t(packetId)};
+
+    _republishedId = qos == 2 ? packetId : 0;
+
+    for (uint8_t i = 0; i < MQTT_INFLIGHT_MAX; ++i) {
+        if (qos == 2 && _inflight[i] == packetId && _released[i]) return writePubrel(packetId);
+    }
+
+    return write(header, headerLength) == headerLength && write(topicHeader, 2) == 2
+           && write(reinterpret_cast<const uint8_t *>(topic), topicLength) == topicLength && write(id, 2) == 2
+           && write(payload, length) == length;
+}
+
+bool MqttTransport::Parser::feed(uint8_t b) {
+    switch (stage) {
+        case TYPE:
+            *this = {};
+            header = b;
+            stage  = LENGTH;
+            return false;
+
+        case LENGTH:
+            remaining |= uint32_t(b & 0x7f) << lengthShift;
+            lengthShift += 7;
+            if (b & 0x80) return false;
+
+            if (remaining == 0) {
+                stage = TYPE;
+                return true;
+            }
+            stage = BODY;
+            return false;
+
+        case BODY:
+            if (header >> 4 == MQTT_PUBLISH) {
+                // topic length, topic, then the packet id if QoS > 0
+                if (position == 0) topicLength = b << 8;
+                else if (position == 1) topicLength |= b;
+                else if (position == topicLength + 2u) packetId = b << 8;
+                else if (position == topicLength + 3u) packetId |= b;
+            } else {
+                // CONNACK: flags, return code; PUBACK/PUBREC/PUBREL/PUBCOMP: packet id
+                if (position == 0) {
+                    flags    = b;
+                    packetId = b << 8;
+                } else if (position == 1) {
+                    packetId |= b;
+                }
+            }
+            ++position;
+
+            if (--remaining) return false;
+
+            stage = TYPE;
+            return true;
+    }
+    return false;
+}
+
+void MqttTransport::onOutgoing(const Parser &packet) {
+    if (packet.header >> 4 != MQTT_PUBLISH) return;
+
+    const uint8_t qos = (packet.header >> 1) & 0x03;
+    if (!qos || !packet.packetId) return;
+
+    _lastPublishId = packet.packetId;
+    if (isInflight(packet.packetId)) return;
+
+    // reuse a free slot, otherwise the oldest id is dropped
+    for (uint8_t i = 0; i < MQTT_INFLIGHT_MAX; ++i) {
+        if (!_inflight[i]) {
+            _inflight[i] = packet.packetId;
+            _released[i] = false;
+            return;
+        }
+    }
+    memmove(_inflight, _inflight + 1, sizeof(_inflight) - sizeof(_inflight[0]));
+    memmove(_released, _released + 1, sizeof(_released) - sizeof(_released[0]));
+    _inflight[MQTT_INFLIGHT_MAX - 1] = packet.packetId;
+    _released[MQTT_INFLIGHT_MAX - 1] = false;
+}
+
+void MqttTransport::onIncoming(const Parser &packet) {
+    switch (packet.header >> 4) {
+        case MQTT_CONNACK:
+            _sessionPresent = packet.flags & 0x01;
+            break;
+        case MQTT_PUBACK:
+        case MQTT_PUBCOMP:
+            forget(packet.packetId);
+            break;
+        case MQTT_PUBREC:
+            for (uint8_t i = 0; i < MQTT_INFLIGHT_MAX; ++i) {
+                if (packet.packetId && _inflight[i] == packet.packetId) _released[i] = true;
+            }
+            if (packet.packetId && packet.packetId == _republishedId) {
+                writePubrel(packet.packetId);
+                _republishedId = 0;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void MqttTransport::feedOutgoing(const uint8_t *buf, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        if (_outgoing.feed(buf[i])) onOutgoing(_outgoing);
+    }
+}
+
+void MqttTransport::feedIncoming(const uint8_t *buf, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        if (_incoming.feed(buf[i])) onIncoming(_incoming);
+    }
+}
+
+bool MqttTransport::writePubrel(uint16_t packetId) {
+    const uint8_t pubrel[4] = {MQTT_PUBREL << 4 | 0x02, 2, uint8_t(packetId >> 8), uint8_t(packetId)};
+    return write(pubrel, sizeof(pubrel)) == sizeof(pubrel);
+}
+
+void MqttTransport::resetParsers() {
+    _outgoing.reset();
+    _incoming.reset();
+}
@@ -0,0 +1,110 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_TRANSPORT_H
+#define LETOVO_COMPUTERS_ARDUINO_TRANSPORT_H
+
+#include <Arduino.h>
+#include <Client.h>
+
+// max number of QoS 1/2 packet ids tracked as unacknowledged at once
+#define MQTT_INFLIGHT_MAX 8
+
+// Pass-through Client that sits between MqttClient and the network client and watches the MQTT packets going
+// both ways. ArduinoMqttClient keeps the CONNACK flags and packet ids to itself, so this is where we learn whether
+// the broker kept our session and which publishes are still unacknowledged.
+class MqttTransport : public Client {
+public:
+    explicit MqttTransport(Client &client) : _client(client) {}
+
+    int connect(IPAddress ip, uint16_t port) override;
+
+    int connect(const char *host, uint16_t port) override;
+
+    size_t write(uint8_t b) override;
+
+    size_t write(const uint8_t *buf, size_t size) override;
+
+    int available() override { return _client.available(); }
+
+    int read() override;
+
+    int read(uint8_t *buf, size_t size) override;
+
+    int peek() override { return _client.peek(); }
+
+    void flush() override { _client.flush(); }
+
+    void stop() override;
+
+    uint8_t connected() override { return _client.connected(); }
+
+    // called with the result of every connect() of the underlying client, e.g. to time the TLS handshake
+    void setConnectHook(void (*hook)(int result)) { _connectHook = hook; }
+
+    operator bool() override { return bool(_client); }
+
+    // session present flag of the latest CONNACK
+    bool sessionPresent() const { return _sessionPresent; }
+
+    // packet id of the latest outgoing QoS 1/2 PUBLISH, 0 if none was sent yet
+    uint16_t lastPublishId() const { return _lastPublishId; }
+
+    // true while neither PUBACK nor PUBCOMP was received for the packet id
+    bool isInflight(uint16_t packetId) const;
+
+    uint8_t inflightCount() const;
+
+    // stop tracking the packet id, e.g. after its message was dropped
+    void forget(uint16_t packetId);
+
+    // sends an unacknowledged QoS 1/2 message again under its packet id, as MQTT requires for a retransmission:
+    // under a new id the broker would deliver it twice. The PUBLISH goes with DUP set, or only the PUBREL if the
+    // PUBREC of a QoS 2 one already came. ArduinoMqttClient only answers the PUBREC of its own publishes, the PUBREL
+    // of a republished one is sent from here.
+    bool republish(const char *topic, const uint8_t *payload, size_t length, bool retain, uint8_t qos,
+                   uint16_t packetId);
+
+private:
+    // incremental parser of the MQTT fixed header and the first bytes of the variable header
+    struct Parser {
+        enum Stage : uint8_t { TYPE, LENGTH, BODY };
+
+        Stage    stage;
+        uint8_t  header;
+        uint8_t  lengthShift;
+        uint32_t remaining;
+        uint32_t position;
+        uint16_t topicLength;
+        uint16_t packetId;
+        uint8_t  flags;
+
+        void reset() { *this = {}; }
+
+        // returns true when a whole packet was consumed
+        bool feed(uint8_t b);
+    };
+
+    void onOutgoing(const Parser &packet);
+
+    void onIncoming(const Parser &packet);
+
+    void feedOutgoing(const uint8_t *buf, size_t size);
+
+    void feedIncoming(const uint8_t *buf, size_t size);
+
+    void resetParsers();
+
+    bool writePubrel(uint16_t packetId);
+
+    Client   &_client;
+    void     (*_connectHook)(int result) = nullptr;
+    Parser   _outgoing       = {};
+    Parser   _incoming       = {};
+    bool     _sessionPresent = false;
+    uint16_t _lastPublishId  = 0;
+    // QoS 2 packet id of the latest republish(), its PUBREC is answered here
+    uint16_t _republishedId  = 0;
+    uint16_t _inflight[MQTT_INFLIGHT_MAX] = {};
+    // the PUBREC of the id in the same slot came, the broker has the message and waits for the PUBREL
+    bool     _released[MQTT_INFLIGHT_MAX] = {};
+};
+
+#endif //LETOVO_COMPUTERS_ARDUINO_TRANSPORT_H
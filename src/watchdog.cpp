@@ -0,0 +1,131 @@
+#include "watchdog.h"
+
+#include "config.h"
+#include "flight_recorder.h"
+
+namespace Watchdog {
+    static const uint8_t NO_ENTRY = UINT8_MAX;
+
+    static const Budget *budgets     = nullptr;
+    static uint8_t       budgetsCount = 0;
+
+    // millis() of the latest finished callback of each task of the table
+    static volatile uint32_t checkedInAt[WATCHDOG_TASKS_MAX] = {};
+
+    // the task in its callback, nullptr between the callbacks, with its budget and the millis() it started at
+    static Task *volatile         running       = nullptr;
+    static volatile unsigned long runningBudget = 0;
+    static volatile uint32_t      runningSince  = 0;
+
+    static uint32_t fedAt   = 0;
+    static bool     started = false;
+    // the WDT is no longer fed after the first violation
+    static bool     tripped = false;
+
+    // the hook that was installed before, the flight recorder
+    static void (*chained)(Task *task) = nullptr;
+
+    static uint8_t entry(const Task *task) {
+        for (uint8_t i = 0; i < budgetsCount; ++i) {
+            if (budgets[i].task == task) return i;
+        }
+        return NO_ENTRY;
+    }
+
+    static void onDispatch(Task *task) {
+        if (chained) chained(task);
+
+        const uint32_t now = millis();
+
+        if (task) {
+            const uint8_t index = entry(task);
+
+            runningSince  = now;
+            runningBudget = index == NO_ENTRY ? WATCHDOG_BUDGET_MS : budgets[index].budget;
+            running       = task;
+            return;
+        }
+
+        const uint32_t elapsed = now - runningSince;
+
+        // the others could not run meanwhile, their deadlines are moved by the time this callback took
+        if (elapsed >= WATCHDOG_FEED_MS) {
+            for (uint8_t i = 0; i < budgetsCount; ++i) checkedInAt[i] += elapsed;
+        }
+
+        // an overrun is a missed check-in, the next callback may still make it before the deadline
+        const uint8_t index = entry(running);
+        if (index != NO_ENTRY && elapsed <= budgets[index].budget) checkedInAt[index] = now;
+
+        running = nullptr;
+    }
+
+    static void trip(const Task *task, uint32_t ms) {
+        tripped = true;
+        FlightRecorder::record(FlightRecorder::WATCHDOG, FlightRecorder::taskIndex(task),
+                               uint16_t(min<uint32_t>(ms, UINT16_MAX)));
+    }
+
+    static void feed() {
+        // a clear while the previous one is synchronized is ignored, it is retried on the next tick
+        if (WDT->STATUS.bit.SYNCBUSY) return;
+
+        WDT->CLEAR.reg = WDT_CLEAR_CLEAR_KEY;
+        fedAt = millis();
+    }
+}
+
+void Watchdog::begin(const Budget *budgetTable, uint8_t count) {
+    budgets      = budgetTable;
+    budgetsCount = min<uint8_t>(count, WATCHDOG_TASKS_MAX);
+
+    const uint32_t now = millis();
+    for (uint8_t i = 0; i < budgetsCount; ++i) checkedInAt[i] = now;
+
+    chained                = SoftTimer.dispatchHook;
+    SoftTimer.dispatchHook = onDispatch;
+
+    // generic clock 2 runs the WDT at 1.024 kHz from the ultra low power oscillator: 32768 Hz / 2^(4 + 1)
+    GCLK->GENDIV.reg = GCLK_GENDIV_ID(2) | GCLK_GENDIV_DIV(4);
+    GCLK->GENCTRL.reg = GCLK_GENCTRL_ID(2) | GCLK_GENCTRL_GENEN | GCLK_GENCTRL_SRC_OSCULP32K | GCLK_GENCTRL_DIVSEL;
+    while (GCLK->STATUS.bit.SYNCBUSY);
+    GCLK->CLKCTRL.reg = GCLK_CLKCTRL_ID_WDT | GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK2;
+
+    // a reset 2048 cycles (2 s) after the latest feed
+    WDT->CTRL.reg = 0;
+    while (WDT->STATUS.bit.SYNCBUSY);
+    WDT->CONFIG.reg = WDT_CONFIG_PER_2K;
+    WDT->CTRL.reg = WDT_CTRL_ENABLE;
+    while (WDT->STATUS.bit.SYNCBUSY);
+
+    fedAt   = now;
+    started = true;
+}
+
+void Watchdog::tick() {
+    if (!started || tripped) return;
+
+    const uint32_t now  = millis();
+    Task *const    task = running;
+
+    if (task && now - runningSince > runningBudget) {
+        trip(task, now - runningSince);
+        return;
+    }
+
+    if (now - fedAt < WATCHDOG_FEED_MS) return;
+
+    // in a callback within its budget nobody else can check in, the deadlines are checked between the callbacks
+    if (!task) {
+        for (uint8_t i = 0; i < budgetsCount; ++i) {
+            const uint32_t silent = now - checkedInAt[i];
+
+            if (budgets[i].deadline && silent > budgets[i].deadline) {
+                trip(budgets[i].task, silent);
+                return;
+            }
+        }
+    }
+
+    feed();
+}
@@ -0,0 +1,33 @@
+#ifndef LETOVO_COMPUTERS_ARDUINO_WATCHDOG_H
+#define LETOVO_COMPUTERS_ARDUINO_WATCHDOG_H
+
+#include <Arduino.h>
+#include <SoftTimer.h>
+
+// max number of tasks with a deadline
+#define WATCHDOG_TASKS_MAX 8
+
+// Supervision of the scheduler by the hardware watchdog (WDT). Every task callback has an execution budget, and the
+// critical tasks also a deadline: the longest time between the ends of two of their callbacks. The SysTick hook feeds
+// the WDT only while the running callback is within its budget and, between the callbacks, every critical task has
+// checked in before its deadline. The first violation is recorded in the flight recorder, then the WDT resets the
+// device a period later. The time a task spends in a callback within its budget does not count against the deadlines
+// of the others, so the blocking broker connect does not trip them.
+namespace Watchdog {
+    struct Budget {
+        Task          *task;
+        // longest callback in ms
+        unsigned long budget;
+        // longest time without a finished callback in ms, 0 if the task is not critical
+        unsigned long deadline;
+    };
+
+    // the table has to outlive the watchdog, tasks that are not in it get WATCHDOG_BUDGET_MS and no deadline;
+    // starts the WDT, so it comes last in setup()
+    void begin(const Budget *budgets, uint8_t count);
+
+    // called from the SysTick interrupt every millisecond
+    void tick();
+}
+
+#endif //LETOVO_COMPUTERS_ARDUINO_WATCHDOG_H